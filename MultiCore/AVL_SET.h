@@ -0,0 +1,515 @@
+#pragma once
+
+#include <iostream>
+#include <mutex>
+#include <atomic>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#include "Common.h"
+#include "OpStats.h"
+#include "LF_SET.h"
+
+// Concurrent relaxed-balance AVL tree (Bronson, Casper, Chafi & Olukotun, "A
+// Practical Concurrent Binary Search Tree").
+//
+// Searches take no locks. They walk down hand over hand with per-node
+// versions: a child is entered only after the parent's version is checked
+// again, and a rotation marks the node it moves down as SHRINKING while it
+// works and bumps its version after, so a search that may have been moved
+// off its key's path retries from the parent. Growing never invalidates a
+// search and is not versioned.
+//
+// Writers lock only the nodes they change: the parent of a new leaf, or a
+// removed node and its parent. A removed node with two children stays as a
+// routing node with present == false. Heights are repaired and rotations
+// done after the update, bottom up, each step under the locks of the few
+// nodes it restructures (parent before child). Unlinked nodes go back through
+// EBR.
+class AVL_NODE {
+public:
+	static constexpr unsigned long long UNLINKED{ 1 };
+	static constexpr unsigned long long SHRINKING{ 2 };
+	static constexpr unsigned long long CHANGE{ 4 }; // one finished shrink
+
+	int key;
+	std::atomic<bool> present;
+	std::atomic<int> height;
+	std::atomic<unsigned long long> version;
+	std::atomic<AVL_NODE*> parent;
+	std::atomic<AVL_NODE*> left;
+	std::atomic<AVL_NODE*> right;
+	std::mutex mtx;
+	int epoch; // For EBR
+
+	AVL_NODE(int k, AVL_NODE* p)
+		: key(k), present(true), height(1), version(0), parent(p), left(nullptr), right(nullptr), epoch(0) {}
+
+	std::atomic<AVL_NODE*>& child(int dir) { return dir < 0 ? left : right; }
+
+	void lock() { mtx.lock(); }
+	void unlock() { mtx.unlock(); }
+};
+
+class AVL_SET {
+	static constexpr int LEFT{ -1 };
+	static constexpr int RIGHT{ 1 };
+
+	enum RESULT { NOT_FOUND, FOUND, RETRY };
+
+	// node_condition(): a new height, or one of these
+	static constexpr int NOTHING_REQUIRED{ -1 };
+	static constexpr int UNLINK_REQUIRED{ -2 };
+	static constexpr int REBALANCE_REQUIRED{ -3 };
+
+	static constexpr int SPINS{ 100 };
+
+public:
+	AVL_SET()
+	{
+		holder = new AVL_NODE(std::numeric_limits<int>::min(), nullptr); // root is holder->right
+		holder->present = false;
+	}
+
+	~AVL_SET()
+	{
+		clear();
+		delete holder;
+	}
+
+	void clear()
+	{
+		std::vector<AVL_NODE*> stack;
+		if (auto root = holder->right.load()) stack.push_back(root);
+
+		while (not stack.empty()) {
+			auto node = stack.back();
+			stack.pop_back();
+			if (auto l = node->left.load()) stack.push_back(l);
+			if (auto r = node->right.load()) stack.push_back(r);
+			delete node;
+		}
+
+		holder->right = nullptr;
+	}
+
+	bool add(int v)
+	{
+		ebr.StartOp();
+		RESULT r;
+		while ((r = attempt_update(v, true, holder, RIGHT, holder->version)) == RETRY);
+		ebr.EndOp();
+		return r == NOT_FOUND;
+	}
+
+	bool remove(int v)
+	{
+		ebr.StartOp();
+		RESULT r;
+		while ((r = attempt_update(v, false, holder, RIGHT, holder->version)) == RETRY);
+		ebr.EndOp();
+		return r == FOUND;
+	}
+
+	bool contains(int v)
+	{
+		ebr.StartRead();
+		RESULT r;
+		while ((r = attempt_get(v, holder, RIGHT, holder->version)) == RETRY);
+		ebr.EndOp();
+		return r == FOUND;
+	}
+
+	void print20()
+	{
+		std::vector<AVL_NODE*> stack;
+		auto curr = holder->right.load();
+
+		int printed{ 0 };
+		while (printed < 20 and (curr != nullptr or not stack.empty())) {
+			while (curr != nullptr) {
+				stack.push_back(curr);
+				curr = curr->left;
+			}
+			curr = stack.back();
+			stack.pop_back();
+
+			if (curr->present) {
+				std::cout << curr->key << ", ";
+				++printed;
+			}
+			curr = curr->right;
+		}
+		std::cout << std::endl;
+	}
+
+private:
+	static int compare(int v, int key) { return v < key ? LEFT : (v > key ? RIGHT : 0); }
+	static int height(AVL_NODE* node) { return node ? node->height.load() : 0; }
+	static bool unbalanced(int bal) { return bal < -1 or bal > 1; }
+
+	// Rotations hold the node's lock while it is SHRINKING.
+	static void wait_until_not_changing(AVL_NODE* node)
+	{
+		const auto v = node->version.load();
+		if ((v & AVL_NODE::SHRINKING) == 0) return;
+
+		for (int i = 0; i < SPINS; ++i) {
+			if (node->version != v) return;
+		}
+		node->lock();
+		node->unlock();
+	}
+
+	// Looks for v below node->child(dir); node had version nodeVersion.
+	RESULT attempt_get(int v, AVL_NODE* node, int dir, unsigned long long nodeVersion)
+	{
+		while (true) {
+			AVL_NODE* child = node->child(dir);
+			if (node->version != nodeVersion) return retry();
+			if (child == nullptr) return NOT_FOUND;
+
+			const int nextDir = compare(v, child->key);
+			if (nextDir == 0) return child->present ? FOUND : NOT_FOUND;
+
+			const auto childVersion = child->version.load();
+			if (childVersion & AVL_NODE::SHRINKING) {
+				wait_until_not_changing(child);
+			}
+			else if ((childVersion & AVL_NODE::UNLINKED) == 0 and child == node->child(dir)) {
+				if (node->version != nodeVersion) return retry();
+
+				STAT_INC(STAT_TRAVERSED);
+				RESULT r = attempt_get(v, child, nextDir, childVersion);
+				if (r != RETRY) return r;
+			}
+		}
+	}
+
+	// add or remove v below node->child(dir). Returns whether v was there.
+	RESULT attempt_update(int v, bool add, AVL_NODE* node, int dir, unsigned long long nodeVersion)
+	{
+		while (true) {
+			AVL_NODE* child = node->child(dir);
+			if (node->version != nodeVersion) return retry();
+
+			if (child == nullptr) {
+				if (not add) return NOT_FOUND;
+
+				AVL_NODE* damaged{ nullptr };
+				node->lock();
+				if (node->version != nodeVersion) {
+					node->unlock();
+					return retry();
+				}
+				if (node->child(dir) == nullptr) {
+					node->child(dir) = ebr.newNode(v, node);
+					damaged = node;
+				}
+				node->unlock();
+
+				if (damaged) {
+					fix_height_and_rebalance(damaged);
+					return NOT_FOUND;
+				}
+				continue; // someone else put a node there
+			}
+
+			const int nextDir = compare(v, child->key);
+			if (nextDir == 0) {
+				RESULT r = attempt_node_update(add, node, child);
+				if (r != RETRY) return r;
+				continue;
+			}
+
+			const auto childVersion = child->version.load();
+			if (childVersion & AVL_NODE::SHRINKING) {
+				wait_until_not_changing(child);
+			}
+			else if ((childVersion & AVL_NODE::UNLINKED) == 0 and child == node->child(dir)) {
+				if (node->version != nodeVersion) return retry();
+
+				STAT_INC(STAT_TRAVERSED);
+				RESULT r = attempt_update(v, add, child, nextDir, childVersion);
+				if (r != RETRY) return r;
+			}
+		}
+	}
+
+	// node holds v; parent is where we came from.
+	RESULT attempt_node_update(bool add, AVL_NODE* parent, AVL_NODE* node)
+	{
+		if (not add) {
+			if (not node->present) return NOT_FOUND;
+
+			if (node->left == nullptr or node->right == nullptr) {
+				// it can go right away; that needs the parent too
+				parent->lock();
+				if ((parent->version & AVL_NODE::UNLINKED) or node->parent != parent) {
+					parent->unlock();
+					return retry();
+				}
+
+				node->lock();
+				RESULT r = node->present ? FOUND : NOT_FOUND;
+				if (r == FOUND and not attempt_unlink_nl(parent, node)) r = RETRY;
+				node->unlock();
+				parent->unlock();
+
+				if (r == FOUND) fix_height_and_rebalance(parent);
+				return r == RETRY ? retry() : r;
+			}
+		}
+
+		node->lock();
+		if (node->version & AVL_NODE::UNLINKED) {
+			node->unlock();
+			return retry();
+		}
+
+		const bool was = node->present;
+		if (was != add) {
+			// a node with at most one child must be unlinked, not emptied
+			if (not add and (node->left == nullptr or node->right == nullptr)) {
+				node->unlock();
+				return retry();
+			}
+			node->present = add;
+		}
+		node->unlock();
+		return was ? FOUND : NOT_FOUND;
+	}
+
+	// parent and node locked; node must have at most one child.
+	bool attempt_unlink_nl(AVL_NODE* parent, AVL_NODE* node)
+	{
+		AVL_NODE* parentLeft = parent->left;
+		AVL_NODE* parentRight = parent->right;
+		if (parentLeft != node and parentRight != node) return false;
+
+		AVL_NODE* left = node->left;
+		AVL_NODE* right = node->right;
+		if (left != nullptr and right != nullptr) return false;
+
+		AVL_NODE* splice = left ? left : right;
+		if (parentLeft == node) parent->left = splice;
+		else parent->right = splice;
+		if (splice) splice->parent = parent;
+
+		node->version = AVL_NODE::UNLINKED;
+		node->present = false;
+		ebr.deleteNode(node);
+		return true;
+	}
+
+	int node_condition(AVL_NODE* node)
+	{
+		AVL_NODE* left = node->left;
+		AVL_NODE* right = node->right;
+		if ((left == nullptr or right == nullptr) and not node->present) return UNLINK_REQUIRED;
+
+		const int h = node->height;
+		const int hL = height(left);
+		const int hR = height(right);
+		const int hRepl = 1 + std::max(hL, hR);
+
+		if (unbalanced(hL - hR)) return REBALANCE_REQUIRED;
+		return h != hRepl ? hRepl : NOTHING_REQUIRED;
+	}
+
+	// Walks up from node fixing heights, unlinking emptied routing nodes
+	// and rotating, until nothing is left to do.
+	void fix_height_and_rebalance(AVL_NODE* node)
+	{
+		while (node != nullptr and node->parent != nullptr) {
+			const int condition = node_condition(node);
+			if (condition == NOTHING_REQUIRED or (node->version & AVL_NODE::UNLINKED)) return;
+
+			if (condition != UNLINK_REQUIRED and condition != REBALANCE_REQUIRED) {
+				node->lock();
+				AVL_NODE* next = fix_height_nl(node);
+				node->unlock();
+				node = next;
+			}
+			else {
+				AVL_NODE* parent = node->parent;
+				AVL_NODE* next = node;
+
+				parent->lock();
+				if ((parent->version & AVL_NODE::UNLINKED) == 0 and node->parent == parent) {
+					node->lock();
+					next = rebalance_nl(parent, node);
+					node->unlock();
+				}
+				parent->unlock();
+				node = next;
+			}
+		}
+	}
+
+	// node locked. Returns the next node to look at, or nullptr.
+	AVL_NODE* fix_height_nl(AVL_NODE* node)
+	{
+		const int condition = node_condition(node);
+		switch (condition) {
+		case REBALANCE_REQUIRED:
+		case UNLINK_REQUIRED:
+			return node;
+		case NOTHING_REQUIRED:
+			return nullptr;
+		default:
+			node->height = condition;
+			return node->parent;
+		}
+	}
+
+	// parent and node locked.
+	AVL_NODE* rebalance_nl(AVL_NODE* parent, AVL_NODE* node)
+	{
+		AVL_NODE* left = node->left;
+		AVL_NODE* right = node->right;
+		if ((left == nullptr or right == nullptr) and not node->present) {
+			return attempt_unlink_nl(parent, node) ? fix_height_nl(parent) : node;
+		}
+
+		const int h = node->height;
+		const int hL = height(left);
+		const int hR = height(right);
+		const int hRepl = 1 + std::max(hL, hR);
+		const int bal = hL - hR;
+
+		if (bal > 1) return rebalance_to_nl(parent, node, LEFT, left, hR);
+		if (bal < -1) return rebalance_to_nl(parent, node, RIGHT, right, hL);
+		if (hRepl != h) {
+			node->height = hRepl;
+			return fix_height_nl(parent);
+		}
+		return nullptr;
+	}
+
+	// node is too tall on side heavy, whose child is nH; the other side has
+	// height hLight. parent and node locked.
+	AVL_NODE* rebalance_to_nl(AVL_NODE* parent, AVL_NODE* node, int heavy, AVL_NODE* nH, int hLight)
+	{
+		AVL_NODE* result{ node }; // look again
+		nH->lock();
+
+		if (height(nH) - hLight > 1) {
+			AVL_NODE* nHL = nH->child(-heavy);
+			const int hHH = height(nH->child(heavy));
+			const int hHL0 = height(nHL);
+
+			if (hHH >= hHL0) {
+				result = rotate_nl(parent, node, heavy, nH, hLight, hHH, nHL, hHL0);
+			}
+			else {
+				bool rotated{ true };
+				nHL->lock();
+
+				const int hHL = height(nHL);
+				if (hHH >= hHL) {
+					result = rotate_nl(parent, node, heavy, nH, hLight, hHH, nHL, hHL);
+				}
+				else {
+					const int hHLH = height(nHL->child(heavy));
+					const int b = hHH - hHLH;
+					if (not unbalanced(b) and not ((hHH == 0 or hHLH == 0) and not nH->present)) {
+						result = rotate_over_nl(parent, node, heavy, nH, hLight, hHH, nHL, hHLH);
+					}
+					else rotated = false;
+				}
+
+				nHL->unlock();
+
+				// a double rotation would leave nH unbalanced; fix nH first
+				if (not rotated) result = rebalance_to_nl(node, nH, -heavy, nHL, hHH);
+			}
+		}
+
+		nH->unlock();
+		return result;
+	}
+
+	// Single rotation: nH takes node's place and node moves down to the light
+	// side, taking nH's inner child nHL along.
+	AVL_NODE* rotate_nl(AVL_NODE* parent, AVL_NODE* node, int heavy, AVL_NODE* nH, int hLight, int hHH, AVL_NODE* nHL, int hHL)
+	{
+		const auto nodeVersion = node->version.load();
+		AVL_NODE* parentLeft = parent->left;
+
+		node->version = nodeVersion | AVL_NODE::SHRINKING;
+
+		node->child(heavy) = nHL;
+		if (nHL) nHL->parent = node;
+		nH->child(-heavy) = node;
+		node->parent = nH;
+		if (parentLeft == node) parent->left = nH;
+		else parent->right = nH;
+		nH->parent = parent;
+
+		const int hRepl = 1 + std::max(hHL, hLight);
+		node->height = hRepl;
+		nH->height = 1 + std::max(hHH, hRepl);
+
+		node->version = nodeVersion + AVL_NODE::CHANGE;
+
+		if (unbalanced(hHL - hLight)) return node;
+		if ((nHL == nullptr or hLight == 0) and not node->present) return node;
+		if (unbalanced(hHH - hRepl)) return nH;
+		if (hHH == 0 and not nH->present) return nH;
+		return fix_height_nl(parent);
+	}
+
+	// Double rotation: nHL, the inner child of nH, takes node's place with nH
+	// and node as its children.
+	AVL_NODE* rotate_over_nl(AVL_NODE* parent, AVL_NODE* node, int heavy, AVL_NODE* nH, int hLight, int hHH, AVL_NODE* nHL, int hHLH)
+	{
+		const auto nodeVersion = node->version.load();
+		const auto heavyVersion = nH->version.load();
+		AVL_NODE* parentLeft = parent->left;
+		AVL_NODE* nHLH = nHL->child(heavy);
+		AVL_NODE* nHLL = nHL->child(-heavy);
+		const int hHLL = height(nHLL);
+
+		node->version = nodeVersion | AVL_NODE::SHRINKING;
+		nH->version = heavyVersion | AVL_NODE::SHRINKING;
+
+		node->child(heavy) = nHLL;
+		if (nHLL) nHLL->parent = node;
+		nH->child(-heavy) = nHLH;
+		if (nHLH) nHLH->parent = nH;
+		nHL->child(heavy) = nH;
+		nH->parent = nHL;
+		nHL->child(-heavy) = node;
+		node->parent = nHL;
+		if (parentLeft == node) parent->left = nHL;
+		else parent->right = nHL;
+		nHL->parent = parent;
+
+		const int hRepl = 1 + std::max(hHLL, hLight);
+		node->height = hRepl;
+		const int hHRepl = 1 + std::max(hHH, hHLH);
+		nH->height = hHRepl;
+		nHL->height = 1 + std::max(hHRepl, hRepl);
+
+		node->version = nodeVersion + AVL_NODE::CHANGE;
+		nH->version = heavyVersion + AVL_NODE::CHANGE;
+
+		if (unbalanced(hHLL - hLight)) return node;
+		if ((nHLL == nullptr or hLight == 0) and not node->present) return node;
+		if (unbalanced(hHRepl - hRepl)) return nHL;
+		return fix_height_nl(parent);
+	}
+
+	static RESULT retry()
+	{
+		STAT_INC(STAT_RESTART);
+		return RETRY;
+	}
+
+private:
+	AVL_NODE* holder;
+
+	BasicEBR<AVL_NODE> ebr;
+};
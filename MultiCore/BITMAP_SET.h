@@ -0,0 +1,186 @@
+#pragma once
+
+#include <iostream>
+#include <atomic>
+#include <bit>
+#include <vector>
+#include <algorithm>
+
+#include "Common.h"
+#include "SimdSearch.h"
+
+// Set of the ints in [0, keys) as one bit per key. add / remove are a single
+// fetch_or / fetch_and on the key's word and contains is one load; there are
+// no nodes, so nothing to allocate or reclaim. Keys outside the range are
+// never members: add() of one returns false. The benchmark builds it with
+// the workload's range as keys.
+//
+// Above the bits sit summary levels, 1 bit per word of the level below, up
+// to a single word. A summary bit is set when its word may be non-empty, so
+// next() / for_each() skip 64 empty words per summary bit instead of scanning
+// them. Only a word going from empty to non-empty or back touches the level
+// above. Clearing a summary bit is followed by a second look at the word, so
+// once the updates stop every non-empty word has its bit set. While updates
+// run, next(), for_each() and size() give a snapshot that is only
+// approximately current, the same as print20() in the other sets.
+//
+// Every level is an array of whole cache lines of words.
+class BITMAP_SET {
+	struct alignas(64) BLOCK {
+		std::atomic<unsigned long long> words[8];
+	};
+	static_assert(sizeof(BLOCK) == 64 and sizeof(std::atomic<unsigned long long>) == 8);
+
+	struct LEVEL {
+		BLOCK* blocks;
+		size_t size; // words
+
+		std::atomic<unsigned long long>& word(size_t w) { return blocks[w / 8].words[w % 8]; }
+	};
+
+public:
+	static constexpr int DEFAULT_KEYS{ 1 << 24 }; // 2MB of bits
+
+	BITMAP_SET(int keys = DEFAULT_KEYS) : keys(keys)
+	{
+		size_t words = (static_cast<size_t>(keys) + 63) / 64;
+		while (true) {
+			const size_t n = std::max<size_t>(words, 1);
+			levels.push_back(LEVEL{ new BLOCK[(n + 7) / 8], n });
+			if (n == 1) break;
+			words = (n + 63) / 64;
+		}
+		clear();
+	}
+
+	~BITMAP_SET()
+	{
+		for (auto& level : levels) delete[] level.blocks;
+	}
+
+	BITMAP_SET(const BITMAP_SET&) = delete;
+	BITMAP_SET& operator=(const BITMAP_SET&) = delete;
+
+	// Only while no operation is in flight.
+	void clear()
+	{
+		for (auto& level : levels) {
+			for (size_t w = 0; w < (level.size + 7) / 8 * 8; ++w) level.word(w).store(0, std::memory_order_relaxed);
+		}
+	}
+
+	bool add(int v)
+	{
+		if (not in_range(v)) return false;
+
+		const size_t w = static_cast<size_t>(v) / 64;
+		const unsigned long long bit = 1ULL << (v % 64);
+		const auto before = levels[0].word(w).fetch_or(bit);
+		if (before == 0) mark_non_empty(0, w);
+		return (before & bit) == 0;
+	}
+
+	bool remove(int v)
+	{
+		if (not in_range(v)) return false;
+
+		const size_t w = static_cast<size_t>(v) / 64;
+		const unsigned long long bit = 1ULL << (v % 64);
+		const auto before = levels[0].word(w).fetch_and(~bit);
+		if (before == bit) mark_empty(0, w);
+		return (before & bit) != 0;
+	}
+
+	bool contains(int v)
+	{
+		if (not in_range(v)) return false;
+		return (levels[0].word(static_cast<size_t>(v) / 64).load() >> (v % 64)) & 1;
+	}
+
+	// The smallest member >= v, or -1.
+	int next(int v)
+	{
+		if (v < 0) v = 0;
+		if (v >= keys) return -1;
+		const long long pos = find(0, static_cast<size_t>(v));
+		return pos < keys ? static_cast<int>(pos) : -1;
+	}
+
+	int min() { return next(0); }
+
+	// Calls f(v) for every member in ascending order.
+	template <class F>
+	void for_each(F f)
+	{
+		for (int v = next(0); v >= 0; v = (v + 1 < keys) ? next(v + 1) : -1) f(v);
+	}
+
+	long long size()
+	{
+		auto& bits = levels[0];
+		return popcount_words(reinterpret_cast<const unsigned long long*>(bits.blocks), bits.size);
+	}
+
+	void print20()
+	{
+		int printed{ 0 };
+		for (int v = next(0); v >= 0 and printed < 20; v = (v + 1 < keys) ? next(v + 1) : -1, ++printed) {
+			std::cout << v << ", ";
+		}
+		std::cout << std::endl;
+	}
+
+private:
+	bool in_range(int v) const { return static_cast<unsigned int>(v) < static_cast<unsigned int>(keys); }
+
+	// levels[level].word(w) went from empty to non-empty.
+	void mark_non_empty(size_t level, size_t w)
+	{
+		for (; level + 1 < levels.size(); ++level, w /= 64) {
+			const auto before = levels[level + 1].word(w / 64).fetch_or(1ULL << (w % 64));
+			if (before != 0) return;
+		}
+	}
+
+	// levels[level].word(w) went empty. If it filled again meanwhile, whoever
+	// filled it may have set the bit above before we cleared it, so look once
+	// more after clearing.
+	void mark_empty(size_t level, size_t w)
+	{
+		for (; level + 1 < levels.size(); ++level, w /= 64) {
+			const unsigned long long bit = 1ULL << (w % 64);
+			const auto before = levels[level + 1].word(w / 64).fetch_and(~bit);
+
+			if (levels[level].word(w).load() != 0) {
+				levels[level + 1].word(w / 64).fetch_or(bit);
+				return;
+			}
+			if (before != bit) return; // the word above still has other bits
+		}
+	}
+
+	// The first set bit at or after pos in levels[level], or a position past
+	// the end.
+	long long find(size_t level, size_t pos)
+	{
+		auto& l = levels[level];
+
+		while (pos / 64 < l.size) {
+			const size_t w = pos / 64;
+			const auto bits = l.word(w).load() & (~0ULL << (pos % 64));
+			if (bits) return static_cast<long long>(w * 64 + std::countr_zero(bits));
+
+			if (level + 1 == levels.size()) break;
+
+			// the next word that may have bits, from the level above
+			const long long up = find(level + 1, w + 1);
+			if (up >= static_cast<long long>(l.size)) break;
+			pos = static_cast<size_t>(up) * 64;
+		}
+		return static_cast<long long>(l.size) * 64;
+	}
+
+private:
+	const int keys;
+	std::vector<LEVEL> levels; // levels[0] is the keys
+};
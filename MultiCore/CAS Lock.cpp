@@ -3,6 +3,10 @@
 #include <atomic>
 #include <mutex>
 #include <chrono>
+#include <string>
+
+#include "LockTrace.h"
+#include "Fairness.h"
 
 const int MAX_THREADS{ 8 };
 
@@ -25,11 +29,14 @@ volatile bool lock_flag{ false };
 
 void CAS_lock()
 {
+	TRACE_LOCK(LOCK_WAIT, &lock_flag);
 	while (not CAS(&lock_flag, false, true));
+	TRACE_LOCK(LOCK_ACQUIRED, &lock_flag);
 }
 
 void CAS_unlock()
 {
+	TRACE_LOCK(LOCK_RELEASED, &lock_flag);
 	std::atomic_thread_fence(std::memory_order_acquire);
 	lock_flag = false;
 }
@@ -43,9 +50,27 @@ void worker_func(const int thread_id, const int loop_count)
 	}
 }
 
-int main()
+int main(int argc, char* argv[])
 {
 	using namespace std::chrono;
+
+	milliseconds duration;
+	if (fairness_mode(argc, argv, duration)) {
+		std::cout << "Fairness (" << duration.count() << " ms per run)\n";
+		for (int num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2) {
+			auto r = run_for(num_threads, duration, [](int) {
+				CAS_lock();
+				sum += 2;
+				CAS_unlock();
+				});
+
+			std::cout << num_threads << " Threads CAS Lock : ";
+			r.print(std::cout);
+			std::cout << std::endl;
+		}
+		return 0;
+	}
+
 	{
 		auto start = high_resolution_clock::now();
 
@@ -61,6 +86,9 @@ int main()
 	{
 		for (int num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2) {
 			sum = 0;
+#if defined(LOCK_TRACE)
+			lock_tracer.start();
+#endif
 			auto start = high_resolution_clock::now();
 
 			std::vector<std::thread> workers(num_threads);
@@ -73,6 +101,10 @@ int main()
 			}
 
 			auto end = high_resolution_clock::now();
+#if defined(LOCK_TRACE)
+			lock_tracer.stop();
+			lock_tracer.write_chrome_trace("CAS Lock " + std::to_string(num_threads) + ".json");
+#endif
 			std::cout << num_threads << " Threads Exec Time = " << duration_cast<milliseconds>(end - start).count();
 			std::cout << "  Sum = " << sum << std::endl;
 		}
@@ -0,0 +1,520 @@
+#pragma once
+
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#include "Common.h"
+#include "OpStats.h"
+#include "LockTrace.h"
+#include "LF_SET.h"
+#include "Workload.h"
+
+class C_NODE {
+public:
+	int value;
+	C_NODE* next;
+	C_NODE(int v) : next(nullptr), value(v) {}
+};
+
+class C_SET {
+public:
+	C_SET()
+	{
+		head = new C_NODE(std::numeric_limits<int>::min());
+		tail = new C_NODE(std::numeric_limits<int>::max());
+		head->next = tail;
+	}
+
+	~C_SET()
+	{
+		clear();
+		delete head;
+		delete tail;
+	}
+
+	void clear()
+	{
+		C_NODE* curr = head->next;
+		while (curr != tail) {
+			C_NODE* temp = curr;
+			curr = curr->next;
+			delete temp;
+		}
+
+		head->next = tail;
+	}
+
+	bool add(int v)
+	{
+		auto prev = head;
+
+		lock();
+		auto curr = prev->next;
+
+		while (curr->value < v) {
+			STAT_INC(STAT_TRAVERSED);
+			prev = curr;
+			curr = curr->next;
+		}
+
+		if (curr->value == v) {
+			unlock();
+			return false;
+		}
+
+		else {
+			auto newNode = new C_NODE(v);
+			newNode->next = curr;
+			prev->next = newNode;
+
+			unlock();
+			return true;
+		}
+	}
+
+	bool remove(int v)
+	{
+		auto prev = head;
+
+		lock();
+		auto curr = prev->next;
+
+		while (curr->value < v) {
+			STAT_INC(STAT_TRAVERSED);
+			prev = curr;
+			curr = curr->next;
+		}
+
+		if (curr->value == v) {
+			prev->next = curr->next;
+			unlock();
+
+			delete curr;
+			return true;
+		}
+
+		else {
+			unlock();
+			return false;
+		}
+	}
+
+	bool contains(int v)
+	{
+		auto curr = head;
+
+		lock();
+		while (curr->value < v) {
+			STAT_INC(STAT_TRAVERSED);
+			curr = curr->next;
+		}
+
+		if (curr->value == v) {
+			unlock();
+			return true;
+		}
+
+		else {
+			unlock();
+			return false;
+		}
+	}
+
+	void print20()
+	{
+		auto curr = head->next;
+
+		for (int i = 0; i < 20 and curr != tail; ++i) {
+			std::cout << curr->value << ", ";
+			curr = curr->next;
+		}
+		std::cout << std::endl;
+	}
+
+	// Appends the keys in [lo, hi) in ascending order. Only while no
+	// operation is in flight.
+	void keys_in(int lo, int hi, std::vector<int>& keys)
+	{
+		auto curr = head->next;
+		while (curr->value < lo) curr = curr->next;
+
+		for (; curr != tail and curr->value < hi; curr = curr->next) keys.push_back(curr->value);
+	}
+
+private:
+	void lock()
+	{
+		TRACE_LOCK(LOCK_WAIT, &mtx);
+		mtx.lock();
+		TRACE_LOCK(LOCK_ACQUIRED, &mtx);
+	}
+
+	void unlock()
+	{
+		TRACE_LOCK(LOCK_RELEASED, &mtx);
+		mtx.unlock();
+	}
+
+private:
+	C_NODE* head;
+	C_NODE* tail;
+	std::mutex mtx;
+};
+
+// Flat-combining C_SET (Hendler, Incze, Shavit & Tzafrir, "Flat Combining and
+// the Synchronization-Parallelism Tradeoff"). A thread publishes its request
+// in its own padded slot. Whoever gets the lock becomes the combiner: it
+// applies every pending request in one sorted pass over the same sequential
+// list and writes back the results, so the lock changes hands once per batch
+// instead of once per operation.
+class C_SET_FC {
+	struct alignas(64) REQUEST {
+		std::atomic<bool> pending{ false };
+		OP_TYPE op;
+		int value;
+		bool result;
+	};
+
+public:
+	C_SET_FC()
+	{
+		head = new C_NODE(std::numeric_limits<int>::min());
+		tail = new C_NODE(std::numeric_limits<int>::max());
+		head->next = tail;
+	}
+
+	~C_SET_FC()
+	{
+		clear();
+		delete head;
+		delete tail;
+	}
+
+	void clear()
+	{
+		C_NODE* curr = head->next;
+		while (curr != tail) {
+			C_NODE* temp = curr;
+			curr = curr->next;
+			delete temp;
+		}
+
+		head->next = tail;
+	}
+
+	bool add(int v)
+	{
+		return apply(OP_ADD, v);
+	}
+
+	bool remove(int v)
+	{
+		return apply(OP_REMOVE, v);
+	}
+
+	bool contains(int v)
+	{
+		return apply(OP_CONTAINS, v);
+	}
+
+	void print20()
+	{
+		auto curr = head->next;
+
+		for (int i = 0; i < 20 and curr != tail; ++i) {
+			std::cout << curr->value << ", ";
+			curr = curr->next;
+		}
+		std::cout << std::endl;
+	}
+
+private:
+	bool apply(OP_TYPE op, int v)
+	{
+		auto& request = requests[threadId];
+		request.op = op;
+		request.value = v;
+		request.pending.store(true, std::memory_order_release);
+
+		while (request.pending.load(std::memory_order_acquire)) {
+			if (try_lock()) {
+				if (request.pending.load(std::memory_order_acquire)) combine();
+				unlock();
+			}
+			else std::this_thread::yield();
+		}
+		return request.result;
+	}
+
+	// One pass over the list for the whole batch. Requests on the same key
+	// take effect in thread order.
+	void combine()
+	{
+		batch.clear();
+		for (int i = 0; i < MAX_THREADS; ++i) {
+			if (requests[i].pending.load(std::memory_order_acquire)) batch.push_back(&requests[i]);
+		}
+		std::stable_sort(batch.begin(), batch.end(), [](REQUEST* a, REQUEST* b) { return a->value < b->value; });
+
+		auto prev = head;
+		auto curr = prev->next;
+
+		for (auto request : batch) {
+			const int v = request->value;
+			while (curr->value < v) {
+				STAT_INC(STAT_TRAVERSED);
+				prev = curr;
+				curr = curr->next;
+			}
+
+			switch (request->op) {
+			case OP_ADD:
+				request->result = curr->value != v;
+				if (request->result) {
+					auto newNode = new C_NODE(v);
+					newNode->next = curr;
+					prev->next = newNode;
+					curr = newNode;
+				}
+				break;
+
+			case OP_REMOVE:
+				request->result = curr->value == v;
+				if (request->result) {
+					prev->next = curr->next;
+					delete curr;
+					curr = prev->next;
+				}
+				break;
+
+			case OP_CONTAINS:
+				request->result = curr->value == v;
+				break;
+			}
+		}
+
+		for (auto request : batch) request->pending.store(false, std::memory_order_release);
+	}
+
+	bool try_lock()
+	{
+		if (false == mtx.try_lock()) return false;
+		TRACE_LOCK(LOCK_ACQUIRED, &mtx);
+		return true;
+	}
+
+	void unlock()
+	{
+		TRACE_LOCK(LOCK_RELEASED, &mtx);
+		mtx.unlock();
+	}
+
+private:
+	C_NODE* head;
+	C_NODE* tail;
+	std::mutex mtx;
+
+	REQUEST requests[MAX_THREADS];
+	std::vector<REQUEST*> batch; // only touched by the combiner
+};
+
+// C_SET whose contains() takes no lock. Writers still serialize on mtx and
+// make the sequence number odd while they change the list; a reader walks the
+// list and keeps its answer only if the sequence number was the same even
+// value before and after. Removed nodes go back through EBR, so a reader that
+// raced a remove never touches freed memory. After MAX_RETRIES failed reads
+// contains() falls back to the lock.
+class SEQ_NODE {
+public:
+	int value;
+	std::atomic<SEQ_NODE*> next;
+	int epoch; // For EBR
+	SEQ_NODE(int v) : value(v), next(nullptr), epoch(0) {}
+};
+
+class C_SET_SEQ {
+public:
+	static constexpr int MAX_RETRIES{ 8 };
+
+	C_SET_SEQ()
+	{
+		head = new SEQ_NODE(std::numeric_limits<int>::min());
+		tail = new SEQ_NODE(std::numeric_limits<int>::max());
+		head->next = tail;
+	}
+
+	~C_SET_SEQ()
+	{
+		clear();
+		delete head;
+		delete tail;
+	}
+
+	void clear()
+	{
+		SEQ_NODE* curr = head->next;
+		while (curr != tail) {
+			SEQ_NODE* temp = curr;
+			curr = curr->next;
+			delete temp;
+		}
+
+		head->next = tail;
+	}
+
+	bool add(int v)
+	{
+		auto prev = head;
+
+		ebr.StartOp();
+		lock();
+		auto curr = prev->next.load(std::memory_order_relaxed);
+
+		while (curr->value < v) {
+			STAT_INC(STAT_TRAVERSED);
+			prev = curr;
+			curr = curr->next.load(std::memory_order_relaxed);
+		}
+
+		if (curr->value == v) {
+			unlock();
+			ebr.EndOp();
+			return false;
+		}
+
+		else {
+			auto newNode = ebr.newNode(v);
+			newNode->next.store(curr, std::memory_order_relaxed);
+
+			write_begin();
+			prev->next.store(newNode, std::memory_order_release);
+			write_end();
+
+			unlock();
+			ebr.EndOp();
+			return true;
+		}
+	}
+
+	bool remove(int v)
+	{
+		auto prev = head;
+
+		ebr.StartOp();
+		lock();
+		auto curr = prev->next.load(std::memory_order_relaxed);
+
+		while (curr->value < v) {
+			STAT_INC(STAT_TRAVERSED);
+			prev = curr;
+			curr = curr->next.load(std::memory_order_relaxed);
+		}
+
+		if (curr->value == v) {
+			write_begin();
+			prev->next.store(curr->next.load(std::memory_order_relaxed), std::memory_order_release);
+			write_end();
+			unlock();
+
+			ebr.deleteNode(curr);
+			ebr.EndOp();
+			return true;
+		}
+
+		else {
+			unlock();
+			ebr.EndOp();
+			return false;
+		}
+	}
+
+	bool contains(int v)
+	{
+		ebr.StartRead();
+
+		for (int retry = 0; retry < MAX_RETRIES; ++retry) {
+			const unsigned int before = seq.load(std::memory_order_acquire);
+			if (before & 1) {
+				STAT_INC(STAT_RESTART);
+				continue;
+			}
+
+			auto curr = head;
+			while (curr->value < v) {
+				STAT_INC(STAT_TRAVERSED);
+				curr = curr->next.load(std::memory_order_acquire);
+			}
+			bool result = curr->value == v;
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (seq.load(std::memory_order_relaxed) == before) {
+				ebr.EndOp();
+				return result;
+			}
+			STAT_INC(STAT_VALIDATE_FAIL);
+		}
+
+		auto curr = head;
+
+		lock();
+		while (curr->value < v) {
+			STAT_INC(STAT_TRAVERSED);
+			curr = curr->next.load(std::memory_order_relaxed);
+		}
+		bool result = curr->value == v;
+		unlock();
+
+		ebr.EndOp();
+		return result;
+	}
+
+	void print20()
+	{
+		auto curr = head->next.load();
+
+		for (int i = 0; i < 20 and curr != tail; ++i) {
+			std::cout << curr->value << ", ";
+			curr = curr->next;
+		}
+		std::cout << std::endl;
+	}
+
+private:
+	void lock()
+	{
+		TRACE_LOCK(LOCK_WAIT, &mtx);
+		mtx.lock();
+		TRACE_LOCK(LOCK_ACQUIRED, &mtx);
+	}
+
+	void unlock()
+	{
+		TRACE_LOCK(LOCK_RELEASED, &mtx);
+		mtx.unlock();
+	}
+
+	// only under mtx
+	void write_begin()
+	{
+		seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	void write_end()
+	{
+		seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+private:
+	SEQ_NODE* head;
+	SEQ_NODE* tail;
+	std::mutex mtx;
+	std::atomic<unsigned int> seq{ 0 };
+
+	BasicEBR<SEQ_NODE> ebr;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <memory>
+
+#include "Common.h"
+#include "Workload.h"
+
+// Streaming replacement for the per-operation HISTORY log. Every key has one
+// net count of successful add - remove, updated with a relaxed fetch_add, so
+// memory is 2 bytes per key however many threads run. Counts are 16 bit and
+// wrap: a key is only misjudged if its real net count is off by a multiple of
+// 65536.
+class ConsistencyChecker {
+public:
+	ConsistencyChecker(int range)
+		: range(range), counters(std::make_unique<std::atomic<short>[]>(range))
+	{
+		clear();
+	}
+
+	void clear()
+	{
+		for (int v = 0; v < range; ++v) counters[v].store(0, std::memory_order_relaxed);
+	}
+
+	void record(int op, int value, bool result)
+	{
+		if (false == result) return;
+		if (op == OP_ADD) counters[value].fetch_add(1, std::memory_order_relaxed);
+		else if (op == OP_REMOVE) counters[value].fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	// Checks the counts on num_threads threads, each owning a slice of the
+	// key range, and compares the verdict with set.contains().
+	template <class SET>
+	bool check(SET& set, int num_threads, std::string& error)
+	{
+		std::vector<int> first_error(num_threads, -1);
+		std::vector<int> error_value(num_threads, 0);
+		std::vector<std::thread> mergers;
+
+		for (int t = 0; t < num_threads; ++t) {
+			mergers.emplace_back([&, t] {
+				threadId = t;
+				const int begin = static_cast<int>(static_cast<long long>(range) * t / num_threads);
+				const int end = static_cast<int>(static_cast<long long>(range) * (t + 1) / num_threads);
+
+				for (int v = begin; v < end; ++v) {
+					const short sum = counters[v].load(std::memory_order_relaxed);
+
+					const bool expected{ sum == 1 };
+					if ((sum < 0) or (sum > 1) or (set.contains(v) != expected)) {
+						first_error[t] = v;
+						error_value[t] = sum;
+						return;
+					}
+				}
+			});
+		}
+
+		for (auto& th : mergers) th.join();
+
+		for (int t = 0; t < num_threads; ++t) {
+			if (first_error[t] < 0) continue;
+
+			const std::string i{ std::to_string(first_error[t]) };
+			const int val{ error_value[t] };
+			if (val < 0) error = "ERROR. The value " + i + " removed while it is not in the set.";
+			else if (val > 1) error = "ERROR. The value " + i + " is added while the set already have it.";
+			else if (val == 0) error = "ERROR. The value " + i + " should not exists.";
+			else error = "ERROR. The value " + i + " shoud exists.";
+			return false;
+		}
+
+		return true;
+	}
+
+private:
+	int range;
+	std::unique_ptr<std::atomic<short>[]> counters;
+};
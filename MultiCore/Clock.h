@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <atomic>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define HAS_RDTSC
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+// Cheap timestamp for per-operation timing. On x86 this is the invariant TSC,
+// elsewhere steady_clock in nanoseconds.
+inline unsigned long long ticks()
+{
+#if defined(HAS_RDTSC)
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+inline double ns_per_tick()
+{
+#if defined(HAS_RDTSC)
+	static const double ratio = [] {
+		using namespace std::chrono;
+
+		auto start = steady_clock::now();
+		auto t0 = ticks();
+		while (steady_clock::now() - start < milliseconds(20));
+		auto t1 = ticks();
+		auto end = steady_clock::now();
+
+		return duration<double, std::nano>(end - start).count() / (t1 - t0);
+	}();
+	return ratio;
+#else
+	return 1.0;
+#endif
+}
+
+// Timestamps that bracket an operation for history checking. The invoke stamp
+// is taken before any of the operation's instructions start; the response
+// stamp only after its stores have drained from the store buffer. With an
+// invariant TSC the stamps are comparable across cores.
+inline unsigned long long invoke_ticks()
+{
+#if defined(HAS_RDTSC)
+	auto t = __rdtsc();
+	_mm_lfence();
+	return t;
+#else
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	return ticks();
+#endif
+}
+
+inline unsigned long long response_ticks()
+{
+#if defined(HAS_RDTSC)
+	_mm_mfence();
+	_mm_lfence();
+	return __rdtsc();
+#else
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	return ticks();
+#endif
+}
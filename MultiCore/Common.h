@@ -0,0 +1,6 @@
+#pragma once
+
+const int MAX_THREADS{ 32 };
+
+inline int num_thread{ 0 };
+inline thread_local int threadId{ 0 };
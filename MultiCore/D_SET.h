@@ -0,0 +1,264 @@
+#pragma once
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <limits>
+#include <vector>
+
+#include "Common.h"
+#include "Workload.h"
+#include "WorkerPool.h"
+#include "C_SET.h"
+
+// Delegation set: the keys are split into SERVERS contiguous ranges of
+// [0, range), each owned by one server thread that keeps it in a sequential
+// C_SET-style list with no locks at all. Keys below the range belong to the
+// first server and keys above it to the last. A client never touches a list
+// node; it hands its requests to the owning server, so only the request rings
+// move between cores.
+//
+// Every (server, client) pair has a single-producer single-consumer ring. A
+// client writes requests into its rings without waiting and posts them in
+// batches of BATCH per server, or earlier at flush(); one release store of
+// the ring's posted count hands over the whole batch. The server sweeps all
+// of its rings, serves every posted request, writes each result where the
+// client asked for it and releases them with one store of the ring's
+// completed count. So results come back asynchronously: post() returns at
+// once and wait() is where a client blocks. The benchmark keeps WINDOW
+// requests in flight per client this way. add / remove / contains are a post
+// and a wait of a single request, for callers that need the answer at once.
+//
+// The servers spin, so the benchmark pins them to the cpus its workers leave
+// free (pin_servers). With no free cpu they stay unpinned and compete with
+// the workers. SERVERS is fixed per instance so that throughput can be
+// compared over the number of owners (D_SET_1 .. D_SET_8 in the benchmark).
+template <int SERVERS = 4>
+class D_SET {
+	static constexpr unsigned int CAPACITY{ 64 }; // requests per ring
+
+	struct REQUEST {
+		OP_TYPE op;
+		int value;
+		bool* result;
+	};
+
+	// Both counts only grow; slot i % CAPACITY is reused once completed has
+	// passed i.
+	struct CHANNEL {
+		alignas(64) std::atomic<unsigned int> posted{ 0 };    // by the client
+		alignas(64) std::atomic<unsigned int> completed{ 0 }; // by the server
+		alignas(64) REQUEST ring[CAPACITY];
+	};
+
+	// Requests a client has written into each of its rings, posted or not
+	struct alignas(64) CLIENT {
+		unsigned int queued[SERVERS]{};
+	};
+
+	struct PARTITION {
+		C_NODE* head;
+		C_NODE* tail;
+		CHANNEL channels[MAX_THREADS];
+		std::thread server;
+	};
+
+public:
+	static constexpr unsigned int BATCH{ 8 }; // requests per post to one server
+	static constexpr int WINDOW{ 32 };        // requests in flight per client in the benchmark
+
+	D_SET(int range = std::numeric_limits<int>::max()) : range(range)
+	{
+		for (auto& p : partitions) {
+			p.head = new C_NODE(std::numeric_limits<int>::min());
+			p.tail = new C_NODE(std::numeric_limits<int>::max());
+			p.head->next = p.tail;
+		}
+		for (auto& p : partitions) p.server = std::thread{ [this, &p] { serve(p); } };
+	}
+
+	~D_SET()
+	{
+		stop = true;
+		for (auto& p : partitions) p.server.join();
+
+		clear();
+		for (auto& p : partitions) {
+			delete p.head;
+			delete p.tail;
+		}
+	}
+
+	// Server i goes to cpus[i % cpus.size()]; an empty list leaves them as they are.
+	void pin_servers(const std::vector<int>& cpus)
+	{
+		if (cpus.empty()) return;
+		for (int i = 0; i < SERVERS; ++i) pin_thread(partitions[i].server, cpus[i % cpus.size()]);
+	}
+
+	// Only while no requests are in flight.
+	void clear()
+	{
+		for (auto& p : partitions) {
+			C_NODE* curr = p.head->next;
+			while (curr != p.tail) {
+				C_NODE* temp = curr;
+				curr = curr->next;
+				delete temp;
+			}
+
+			p.head->next = p.tail;
+		}
+	}
+
+	bool add(int v)
+	{
+		return delegate(OP_ADD, v);
+	}
+
+	bool remove(int v)
+	{
+		return delegate(OP_REMOVE, v);
+	}
+
+	bool contains(int v)
+	{
+		return delegate(OP_CONTAINS, v);
+	}
+
+	// Queues the request; *result is written by the server when it is served,
+	// which is certain only after the next wait(). Requests of one client to
+	// the same key are served in the order they were posted.
+	void post(OP_TYPE op, int v, bool* result)
+	{
+		const int s = owner(v);
+		auto& channel = partitions[s].channels[threadId];
+		auto& queued = clients[threadId].queued[s];
+
+		if (queued - channel.completed.load(std::memory_order_acquire) == CAPACITY) {
+			// the ring is full: hand over what is queued and wait for a slot
+			channel.posted.store(queued, std::memory_order_release);
+			while (queued - channel.completed.load(std::memory_order_acquire) == CAPACITY) std::this_thread::yield();
+		}
+
+		channel.ring[queued % CAPACITY] = REQUEST{ op, v, result };
+		++queued;
+
+		if (queued - channel.posted.load(std::memory_order_relaxed) == BATCH) {
+			channel.posted.store(queued, std::memory_order_release);
+		}
+	}
+
+	// Hands over every request still queued, without waiting.
+	void flush()
+	{
+		for (int s = 0; s < SERVERS; ++s) {
+			auto& channel = partitions[s].channels[threadId];
+			const unsigned int queued = clients[threadId].queued[s];
+			if (channel.posted.load(std::memory_order_relaxed) != queued) {
+				channel.posted.store(queued, std::memory_order_release);
+			}
+		}
+	}
+
+	// Returns once every request this client has posted is served.
+	void wait()
+	{
+		flush();
+		for (int s = 0; s < SERVERS; ++s) {
+			auto& channel = partitions[s].channels[threadId];
+			const unsigned int queued = clients[threadId].queued[s];
+			while (channel.completed.load(std::memory_order_acquire) != queued) std::this_thread::yield();
+		}
+	}
+
+	void print20()
+	{
+		// the partitions are in key order
+		int printed{ 0 };
+		for (auto& p : partitions) {
+			for (C_NODE* curr = p.head->next; curr != p.tail and printed < 20; curr = curr->next, ++printed) {
+				std::cout << curr->value << ", ";
+			}
+		}
+		std::cout << std::endl;
+	}
+
+private:
+	int owner(int v) const
+	{
+		if (v <= 0) return 0;
+		if (v >= range) return SERVERS - 1;
+		return static_cast<int>(static_cast<long long>(v) * SERVERS / range);
+	}
+
+	bool delegate(OP_TYPE op, int v)
+	{
+		bool result;
+		post(op, v, &result);
+		wait();
+		return result;
+	}
+
+	void serve(PARTITION& p)
+	{
+		while (not stop.load(std::memory_order_relaxed)) {
+			bool served{ false };
+
+			for (auto& channel : p.channels) {
+				const unsigned int posted = channel.posted.load(std::memory_order_acquire);
+				unsigned int i = channel.completed.load(std::memory_order_relaxed);
+				if (i == posted) continue;
+
+				for (; i != posted; ++i) {
+					auto& request = channel.ring[i % CAPACITY];
+					*request.result = apply(p, request.op, request.value);
+				}
+				channel.completed.store(posted, std::memory_order_release);
+				served = true;
+			}
+
+			if (not served) std::this_thread::yield();
+		}
+	}
+
+	// C_SET's operations, without the lock.
+	static bool apply(PARTITION& p, OP_TYPE op, int v)
+	{
+		auto prev = p.head;
+		auto curr = prev->next;
+
+		while (curr->value < v) {
+			prev = curr;
+			curr = curr->next;
+		}
+
+		switch (op) {
+		case OP_ADD:
+			if (curr->value == v) return false;
+			else {
+				auto newNode = new C_NODE(v);
+				newNode->next = curr;
+				prev->next = newNode;
+				return true;
+			}
+
+		case OP_REMOVE:
+			if (curr->value != v) return false;
+			else {
+				prev->next = curr->next;
+				delete curr;
+				return true;
+			}
+
+		default:
+			return curr->value == v;
+		}
+	}
+
+private:
+	const int range;
+	PARTITION partitions[SERVERS];
+	CLIENT clients[MAX_THREADS];
+	std::atomic<bool> stop{ false };
+};
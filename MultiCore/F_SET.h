@@ -0,0 +1,381 @@
+#pragma once
+
+#include <iostream>
+#include <mutex>
+#include <atomic>
+#include <limits>
+
+#include "Common.h"
+#include "OpStats.h"
+#include "LockTrace.h"
+#include "LF_SET.h"
+
+class F_NODE {
+public:
+	int value;
+	F_NODE* next;
+	std::mutex mtx;
+
+	F_NODE(int v) : next(nullptr), value(v) {}
+
+	void lock()
+	{
+		TRACE_LOCK(LOCK_WAIT, &mtx);
+		mtx.lock();
+		TRACE_LOCK(LOCK_ACQUIRED, &mtx);
+	}
+
+	void unlock()
+	{
+		TRACE_LOCK(LOCK_RELEASED, &mtx);
+		mtx.unlock();
+	}
+};
+
+class F_SET {
+public:
+	F_SET()
+	{
+		head = new F_NODE(std::numeric_limits<int>::min());
+		tail = new F_NODE(std::numeric_limits<int>::max());
+		head->next = tail;
+	}
+
+	~F_SET()
+	{
+		clear();
+		delete head;
+		delete tail;
+	}
+
+	void clear()
+	{
+		F_NODE* curr = head->next;
+		while (curr != tail) {
+			F_NODE* temp = curr;
+			curr = curr->next;
+			delete temp;
+		}
+
+		head->next = tail;
+	}
+
+	bool add(int v)
+	{
+		auto prev = head;
+		prev->lock();
+
+		auto curr = prev->next;
+		curr->lock();
+
+		while (curr->value < v) {
+			STAT_INC(STAT_TRAVERSED);
+			prev->unlock();
+			prev = curr;
+			curr = curr->next;
+			curr->lock();
+		}
+		
+		if (curr->value == v) {
+			prev->unlock();
+			curr->unlock();
+
+			return false;
+		}
+
+		else {
+			auto newNode = new F_NODE(v);
+			newNode->next = curr;
+			prev->next = newNode;
+
+			prev->unlock();
+			curr->unlock();
+
+			return true;
+		}
+	}
+
+	bool remove(int v)
+	{
+		auto prev = head;
+		prev->lock();
+
+		auto curr = prev->next;
+		curr->lock();
+
+		while (curr->value < v) {
+			STAT_INC(STAT_TRAVERSED);
+			prev->unlock();
+			prev = curr;
+			curr = curr->next;
+			curr->lock();
+		}
+		
+		if (curr->value == v) {
+			prev->next = curr->next;
+
+			prev->unlock();
+			curr->unlock();
+
+			delete curr;
+			return true;
+		}
+
+		else {
+			prev->unlock();
+			curr->unlock();
+
+			return false;
+		}
+	}
+
+	bool contains(int v)
+	{
+		auto prev = head;
+		prev->lock();
+
+		auto curr = prev->next;
+		curr->lock();
+
+		while (curr->value < v) {
+			STAT_INC(STAT_TRAVERSED);
+			prev->unlock();
+			prev = curr;
+			curr = curr->next;
+			curr->lock();
+		}
+
+		if (curr->value == v) {
+			prev->unlock();
+			curr->unlock();
+
+			return true;
+		}
+
+		else {
+			prev->unlock();
+			curr->unlock();
+
+			return false;
+		}
+	}
+
+	void print20()
+	{
+		auto curr = head->next;
+
+		for (int i = 0; i < 20 and curr != tail; ++i) {
+			std::cout << curr->value << ", ";
+			curr = curr->next;
+		}
+		std::cout << std::endl;
+	}
+
+private:
+	F_NODE* head;
+	F_NODE* tail;
+};
+
+// F_SET with optimistic lock coupling (Leis et al., "The ART of Practical
+// Synchronization"): every node has a version word instead of a mutex. A
+// traversal reads a node's version, follows its next pointer and checks the
+// version again after reading the next node's, so a read writes nothing. A
+// writer turns the versions it read into locks with a CAS, only on the nodes
+// it changes: prev for add, prev and curr for remove. Every unlock bumps the
+// version; a removed node is also marked obsolete and goes back through EBR.
+class OLC_NODE {
+public:
+	static constexpr unsigned long long OBSOLETE{ 1 };
+	static constexpr unsigned long long LOCKED{ 2 };
+
+	int value;
+	std::atomic<OLC_NODE*> next;
+	std::atomic<unsigned long long> version; // counter << 2 | LOCKED | OBSOLETE
+	int epoch; // For EBR
+
+	OLC_NODE(int v) : value(v), next(nullptr), version(0), epoch(0) {}
+
+	// false if the node is locked or obsolete
+	bool read_lock(unsigned long long& v) const
+	{
+		v = version.load(std::memory_order_acquire);
+		return (v & (LOCKED | OBSOLETE)) == 0;
+	}
+
+	// whether the node is unchanged since read_lock() returned v
+	bool check(unsigned long long v) const
+	{
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return version.load(std::memory_order_relaxed) == v;
+	}
+
+	bool upgrade(unsigned long long v)
+	{
+		if (false == version.compare_exchange_strong(v, v + LOCKED)) return false;
+		TRACE_LOCK(LOCK_ACQUIRED, this);
+		return true;
+	}
+
+	void unlock()
+	{
+		TRACE_LOCK(LOCK_RELEASED, this);
+		version.fetch_add(LOCKED, std::memory_order_release);
+	}
+
+	void unlock_obsolete()
+	{
+		TRACE_LOCK(LOCK_RELEASED, this);
+		version.fetch_add(LOCKED | OBSOLETE, std::memory_order_release);
+	}
+};
+
+class F_SET_OLC {
+public:
+	F_SET_OLC()
+	{
+		head = new OLC_NODE(std::numeric_limits<int>::min());
+		tail = new OLC_NODE(std::numeric_limits<int>::max());
+		head->next = tail;
+	}
+
+	~F_SET_OLC()
+	{
+		clear();
+		delete head;
+		delete tail;
+	}
+
+	void clear()
+	{
+		OLC_NODE* curr = head->next;
+		while (curr != tail) {
+			OLC_NODE* temp = curr;
+			curr = curr->next;
+			delete temp;
+		}
+
+		head->next = tail;
+	}
+
+	bool add(int v)
+	{
+		ebr.StartOp();
+
+		while (true) {
+			OLC_NODE *prev, *curr;
+			unsigned long long prevVersion, currVersion;
+			if (false == find(v, prev, prevVersion, curr, currVersion)) continue;
+
+			if (curr->value == v) {
+				ebr.EndOp();
+				return false;
+			}
+
+			if (false == prev->upgrade(prevVersion)) {
+				STAT_INC(STAT_CAS_FAIL);
+				continue;
+			}
+
+			auto newNode = ebr.newNode(v);
+			newNode->next.store(curr, std::memory_order_relaxed);
+			prev->next.store(newNode, std::memory_order_release);
+			prev->unlock();
+
+			ebr.EndOp();
+			return true;
+		}
+	}
+
+	bool remove(int v)
+	{
+		ebr.StartOp();
+
+		while (true) {
+			OLC_NODE *prev, *curr;
+			unsigned long long prevVersion, currVersion;
+			if (false == find(v, prev, prevVersion, curr, currVersion)) continue;
+
+			if (curr->value != v) {
+				ebr.EndOp();
+				return false;
+			}
+
+			if (false == prev->upgrade(prevVersion)) {
+				STAT_INC(STAT_CAS_FAIL);
+				continue;
+			}
+			if (false == curr->upgrade(currVersion)) {
+				STAT_INC(STAT_CAS_FAIL);
+				prev->unlock();
+				continue;
+			}
+
+			prev->next.store(curr->next.load(std::memory_order_relaxed), std::memory_order_release);
+			prev->unlock();
+			curr->unlock_obsolete();
+
+			ebr.deleteNode(curr);
+			ebr.EndOp();
+			return true;
+		}
+	}
+
+	bool contains(int v)
+	{
+		ebr.StartRead();
+
+		while (true) {
+			OLC_NODE *prev, *curr;
+			unsigned long long prevVersion, currVersion;
+			if (false == find(v, prev, prevVersion, curr, currVersion)) continue;
+
+			bool result = curr->value == v;
+			ebr.EndOp();
+			return result;
+		}
+	}
+
+	void print20()
+	{
+		auto curr = head->next.load();
+
+		for (int i = 0; i < 20 and curr != tail; ++i) {
+			std::cout << curr->value << ", ";
+			curr = curr->next;
+		}
+		std::cout << std::endl;
+	}
+
+private:
+	// prev -> curr with prev->value < v <= curr->value, both read-locked at
+	// the returned versions; false when a version check failed.
+	bool find(int v, OLC_NODE*& prev, unsigned long long& prevVersion, OLC_NODE*& curr, unsigned long long& currVersion)
+	{
+		prev = head;
+		if (false == prev->read_lock(prevVersion)) return restart();
+
+		while (true) {
+			curr = prev->next.load(std::memory_order_acquire);
+			if (false == curr->read_lock(currVersion)) return restart();
+			if (false == prev->check(prevVersion)) return restart();
+
+			if (curr->value >= v) return true;
+
+			STAT_INC(STAT_TRAVERSED);
+			prev = curr;
+			prevVersion = currVersion;
+		}
+	}
+
+	bool restart()
+	{
+		STAT_INC(STAT_RESTART);
+		return false;
+	}
+
+private:
+	OLC_NODE* head;
+	OLC_NODE* tail;
+
+	BasicEBR<OLC_NODE> ebr;
+};
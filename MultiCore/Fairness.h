@@ -0,0 +1,153 @@
+#pragma once
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdlib>
+
+#include "Clock.h"
+
+// Fairness of a run where every thread works for the same fixed time: how the
+// completed operations are spread over the threads and the longest time a
+// single operation (lock acquisition included) took.
+struct FairnessResult {
+	std::vector<long long> ops;         // completed operations per thread
+	unsigned long long longest{ 0 };    // longest single operation, in ticks
+	double ms{ 0.0 };
+
+	long long total() const
+	{
+		long long sum{ 0 };
+		for (auto x : ops) sum += x;
+		return sum;
+	}
+
+	double max_min() const
+	{
+		auto [lo, hi] = std::minmax_element(ops.begin(), ops.end());
+		if (*lo == 0) return HUGE_VAL;
+		return static_cast<double>(*hi) / *lo;
+	}
+
+	// Jain's index (sum x)^2 / (n * sum x^2): 1 when every thread did the
+	// same amount, 1/n when one thread did everything.
+	double jain() const
+	{
+		double sum{ 0.0 }, sq{ 0.0 };
+		for (auto x : ops) {
+			sum += static_cast<double>(x);
+			sq += static_cast<double>(x) * x;
+		}
+		if (sq == 0.0) return 0.0;
+		return sum * sum / (ops.size() * sq);
+	}
+
+	void merge(const FairnessResult& other)
+	{
+		if (ops.size() < other.ops.size()) ops.resize(other.ops.size(), 0);
+		for (size_t i = 0; i < other.ops.size(); ++i) ops[i] += other.ops[i];
+		longest = std::max(longest, other.longest);
+		ms += other.ms;
+	}
+
+	void print(std::ostream& out) const
+	{
+		if (ops.empty()) return;
+
+		auto [lo, hi] = std::minmax_element(ops.begin(), ops.end());
+		out << "ops/thread min " << *lo << " max " << *hi
+			<< "  max/min " << std::fixed << std::setprecision(2) << max_min()
+			<< "  Jain " << std::setprecision(3) << jain()
+			<< "  longest " << std::setprecision(1) << longest * ns_per_tick() / 1'000.0 << " us";
+	}
+};
+
+// Runs op(thread_id) on num_threads threads over and over until duration has
+// passed since the last thread was ready, and counts what each thread did.
+template <class OP>
+FairnessResult run_for(int num_threads, std::chrono::milliseconds duration, OP&& op)
+{
+	using namespace std::chrono;
+
+	struct alignas(64) Slot {
+		long long ops{ 0 };
+		unsigned long long longest{ 0 };
+	};
+
+	std::vector<Slot> slots(num_threads);
+	std::atomic<int> ready{ 0 };
+	std::atomic<bool> stop{ false };
+
+	std::vector<std::thread> workers;
+	for (int i = 0; i < num_threads; ++i) {
+		workers.emplace_back([&, i] {
+			Slot s;
+			ready++;
+			while (ready.load() <= num_threads);
+
+			auto t0 = ticks();
+			while (not stop.load(std::memory_order_relaxed)) {
+				op(i);
+				auto t1 = ticks();
+				s.longest = std::max(s.longest, t1 - t0);
+				s.ops++;
+				t0 = t1;
+			}
+			slots[i] = s;
+		});
+	}
+
+	while (ready.load() < num_threads) std::this_thread::yield();
+	auto start = high_resolution_clock::now();
+	ready++;
+	std::this_thread::sleep_for(duration);
+	stop = true;
+	auto end = high_resolution_clock::now();
+
+	for (auto& th : workers) th.join();
+
+	FairnessResult result;
+	result.ms = duration_cast<microseconds>(end - start).count() / 1'000.0;
+	for (auto& s : slots) {
+		result.ops.push_back(s.ops);
+		result.longest = std::max(result.longest, s.longest);
+	}
+	return result;
+}
+
+// "--fairness" or "--fairness=MS" on the command line switches a lock program
+// from a fixed number of iterations to run_for() with that duration. Anything
+// else starting with "--fairness" prints the usage and exits.
+inline bool fairness_mode(int argc, char* argv[], std::chrono::milliseconds& duration)
+{
+	for (int i = 1; i < argc; ++i) {
+		std::string arg{ argv[i] };
+		if (arg.rfind("--fairness", 0) != 0) continue;
+
+		duration = std::chrono::milliseconds{ 1'000 };
+		if (arg.size() == 10) return true;
+
+		try {
+			size_t used{ 0 };
+			const std::string value = arg.substr(11);
+			const int ms = (arg[10] == '=') ? std::stoi(value, &used) : 0;
+			if (used == value.size() and ms > 0) {
+				duration = std::chrono::milliseconds{ ms };
+				return true;
+			}
+		}
+		catch (const std::exception&) {
+		}
+
+		std::cout << "Usage: [--fairness[=MS]]   MS > 0, run each lock for MS milliseconds (default: 1000)\n";
+		std::exit(-1);
+	}
+	return false;
+}
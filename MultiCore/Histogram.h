@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <bit>
+
+// Log-bucketed latency histogram in the style of HdrHistogram: every power of
+// two is split into SUB_BUCKETS linear buckets, so the relative error of a
+// recorded value is below 1 / SUB_BUCKETS.
+class Histogram {
+public:
+	static constexpr int SUB_BITS{ 5 };
+	static constexpr int SUB_BUCKETS{ 1 << SUB_BITS };
+	static constexpr int BUCKETS{ (64 - SUB_BITS + 1) * SUB_BUCKETS };
+
+	void record(unsigned long long v)
+	{
+		counts[index(v)]++;
+		total++;
+		if (v > max_value) max_value = v;
+	}
+
+	void merge(const Histogram& other)
+	{
+		for (int i = 0; i < BUCKETS; ++i) counts[i] += other.counts[i];
+		total += other.total;
+		if (other.max_value > max_value) max_value = other.max_value;
+	}
+
+	void clear()
+	{
+		counts = {};
+		total = 0;
+		max_value = 0;
+	}
+
+	unsigned long long count() const { return total; }
+	unsigned long long max() const { return max_value; }
+
+	unsigned long long percentile(double p) const
+	{
+		if (total == 0) return 0;
+
+		unsigned long long rank = static_cast<unsigned long long>(p / 100.0 * total);
+		if (rank >= total) rank = total - 1;
+
+		unsigned long long seen{ 0 };
+		for (int i = 0; i < BUCKETS; ++i) {
+			seen += counts[i];
+			if (seen > rank) {
+				auto v = highest_equivalent(i);
+				return v < max_value ? v : max_value;
+			}
+		}
+
+		return max_value;
+	}
+
+private:
+	static int index(unsigned long long v)
+	{
+		if (v < SUB_BUCKETS) return static_cast<int>(v);
+
+		int shift = static_cast<int>(std::bit_width(v)) - 1 - SUB_BITS;
+		return (shift + 1) * SUB_BUCKETS + static_cast<int>((v >> shift) - SUB_BUCKETS);
+	}
+
+	static unsigned long long highest_equivalent(int i)
+	{
+		if (i < SUB_BUCKETS) return i;
+
+		int shift = i / SUB_BUCKETS - 1;
+		unsigned long long sub = i % SUB_BUCKETS + SUB_BUCKETS;
+		return ((sub + 1) << shift) - 1;
+	}
+
+private:
+	std::array<unsigned long long, BUCKETS> counts{};
+	unsigned long long total{ 0 };
+	unsigned long long max_value{ 0 };
+};
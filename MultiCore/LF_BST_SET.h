@@ -0,0 +1,280 @@
+#pragma once
+
+#include <iostream>
+#include <atomic>
+#include <limits>
+#include <vector>
+
+#include "Common.h"
+#include "OpStats.h"
+#include "LF_SET.h"
+
+// Lock-free external binary search tree (Natarajan & Mittal, "Fast Concurrent
+// Lock-Free Binary Search Trees"). Keys live in the leaves; internal nodes only
+// route, left for key < node->key. A remove flags the edge to its leaf, then
+// tags the edge to the leaf's sibling so it cannot change, and finally swings
+// the edge above the tagged chain to the sibling. Every step is a CAS on an
+// edge; the two low bits of an edge are the flag and the tag, the same bit
+// stealing as AMR with one more bit. Unlinked nodes go back through EBR.
+//
+// The three sentinel keys at the top of the int range are not valid keys.
+// The tree is not balanced: inserting keys in sorted order makes it a list.
+
+class BST_NODE;
+
+class BST_EDGE { // child pointer | TAG | FLAG
+	std::atomic<long long> word;
+
+public:
+	static constexpr long long FLAG{ 1 }; // the leaf below is being removed
+	static constexpr long long TAG{ 2 };  // the edge must not change any more
+
+	BST_EDGE(BST_NODE* ptr = nullptr) : word(reinterpret_cast<long long>(ptr)) {}
+
+	long long load() const { return word.load(); }
+	void store(BST_NODE* ptr) { word.store(reinterpret_cast<long long>(ptr)); }
+
+	bool CAS(long long expected, long long desired) { return word.compare_exchange_strong(expected, desired); }
+	void Tag() { word.fetch_or(TAG); }
+
+	static BST_NODE* ptr(long long w) { return reinterpret_cast<BST_NODE*>(w & ~(FLAG | TAG)); }
+	static bool flagged(long long w) { return (w & FLAG) != 0; }
+	static bool tagged(long long w) { return (w & TAG) != 0; }
+	static long long clean(BST_NODE* p) { return reinterpret_cast<long long>(p); }
+};
+
+class BST_NODE {
+public:
+	int key;
+	BST_EDGE left;
+	BST_EDGE right; // both null for a leaf
+	int epoch; // For EBR
+
+	BST_NODE(int k, BST_NODE* l = nullptr, BST_NODE* r = nullptr) : key(k), left(l), right(r), epoch(0) {}
+
+	BST_EDGE& child(int k) { return k < key ? left : right; }
+};
+
+class LF_BST_SET {
+	static constexpr int INF0{ std::numeric_limits<int>::max() - 2 };
+	static constexpr int INF1{ std::numeric_limits<int>::max() - 1 };
+	static constexpr int INF2{ std::numeric_limits<int>::max() };
+
+	// ancestor -> successor is the last untagged edge on the path to leaf
+	struct SEEK_RECORD {
+		BST_NODE* ancestor;
+		BST_NODE* successor;
+		BST_NODE* parent;
+		BST_NODE* leaf;
+	};
+
+public:
+	LF_BST_SET()
+	{
+		S = new BST_NODE(INF1, new BST_NODE(INF0), new BST_NODE(INF1));
+		R = new BST_NODE(INF2, S, new BST_NODE(INF2));
+	}
+
+	~LF_BST_SET()
+	{
+		destroy(R);
+	}
+
+	void clear()
+	{
+		destroy(BST_EDGE::ptr(S->left.load()));
+		S->left.store(new BST_NODE(INF0));
+	}
+
+	bool add(int v)
+	{
+		ebr.StartOp();
+
+		while (true) {
+			SEEK_RECORD r;
+			seek(v, r);
+
+			if (r.leaf->key == v) {
+				ebr.EndOp();
+				return false;
+			}
+
+			auto newLeaf = ebr.newNode(v, nullptr, nullptr);
+			auto internal = (v < r.leaf->key)
+				? ebr.newNode(r.leaf->key, newLeaf, r.leaf)
+				: ebr.newNode(v, r.leaf, newLeaf);
+
+			auto& edge = r.parent->child(v);
+			if (edge.CAS(BST_EDGE::clean(r.leaf), BST_EDGE::clean(internal))) {
+				ebr.EndOp();
+				return true;
+			}
+			STAT_INC(STAT_CAS_FAIL);
+			ebr.deleteNode(newLeaf);
+			ebr.deleteNode(internal);
+
+			// help the remove that is in the way
+			long long w = edge.load();
+			if (BST_EDGE::ptr(w) == r.leaf and (BST_EDGE::flagged(w) or BST_EDGE::tagged(w))) cleanup(v, r);
+		}
+	}
+
+	bool remove(int v)
+	{
+		ebr.StartOp();
+
+		BST_NODE* leaf{ nullptr }; // set once our flag is in
+		while (true) {
+			SEEK_RECORD r;
+			seek(v, r);
+
+			if (leaf == nullptr) {
+				if (r.leaf->key != v) {
+					ebr.EndOp();
+					return false;
+				}
+
+				auto& edge = r.parent->child(v);
+				if (edge.CAS(BST_EDGE::clean(r.leaf), BST_EDGE::clean(r.leaf) | BST_EDGE::FLAG)) {
+					leaf = r.leaf;
+					if (cleanup(v, r)) break;
+				}
+				else {
+					STAT_INC(STAT_MARK_FAIL);
+					long long w = edge.load();
+					if (BST_EDGE::ptr(w) == r.leaf and (BST_EDGE::flagged(w) or BST_EDGE::tagged(w))) cleanup(v, r);
+				}
+			}
+
+			else {
+				if (r.leaf != leaf) break; // someone finished it for us
+				if (cleanup(v, r)) break;
+			}
+		}
+
+		ebr.EndOp();
+		return true;
+	}
+
+	bool contains(int v)
+	{
+		ebr.StartOp();
+
+		SEEK_RECORD r;
+		seek(v, r);
+		bool result = r.leaf->key == v;
+
+		ebr.EndOp();
+		return result;
+	}
+
+	void print20()
+	{
+		std::vector<BST_NODE*> stack{ BST_EDGE::ptr(S->left.load()) };
+
+		int printed{ 0 };
+		while (printed < 20 and not stack.empty()) {
+			auto node = stack.back();
+			stack.pop_back();
+
+			auto l = BST_EDGE::ptr(node->left.load());
+			if (l == nullptr) {
+				if (node->key < INF0) {
+					std::cout << node->key << ", ";
+					++printed;
+				}
+				continue;
+			}
+			stack.push_back(BST_EDGE::ptr(node->right.load()));
+			stack.push_back(l);
+		}
+		std::cout << std::endl;
+	}
+
+private:
+	void seek(int v, SEEK_RECORD& r)
+	{
+		r.ancestor = R;
+		r.successor = S;
+		r.parent = S;
+		r.leaf = BST_EDGE::ptr(S->left.load());
+
+		long long parentField = S->left.load();
+		long long currentField = r.leaf->left.load();
+		BST_NODE* current = BST_EDGE::ptr(currentField);
+
+		while (current != nullptr) {
+			if (not BST_EDGE::tagged(parentField)) {
+				r.ancestor = r.parent;
+				r.successor = r.leaf;
+			}
+
+			STAT_INC(STAT_TRAVERSED);
+			r.parent = r.leaf;
+			r.leaf = current;
+			parentField = currentField;
+
+			currentField = current->child(v).load();
+			current = BST_EDGE::ptr(currentField);
+		}
+	}
+
+	// Removes the flagged leaf under r.parent (ours or its sibling) by
+	// swinging ancestor -> successor to the other child of r.parent.
+	bool cleanup(int v, const SEEK_RECORD& r)
+	{
+		auto& successorEdge = r.ancestor->child(v);
+
+		BST_EDGE* childEdge = &r.parent->child(v);
+		BST_EDGE* siblingEdge = (childEdge == &r.parent->left) ? &r.parent->right : &r.parent->left;
+		if (not BST_EDGE::flagged(childEdge->load())) siblingEdge = childEdge; // the sibling is the one going
+
+		siblingEdge->Tag();
+		long long w = siblingEdge->load();
+		BST_NODE* keep = BST_EDGE::ptr(w);
+
+		if (false == successorEdge.CAS(BST_EDGE::clean(r.successor), BST_EDGE::clean(keep) | (w & BST_EDGE::FLAG))) {
+			STAT_INC(STAT_CAS_FAIL);
+			return false;
+		}
+
+		retire_chain(v, r.successor, r.parent, keep);
+		return true;
+	}
+
+	// Every edge from successor down to parent is tagged, and the other child
+	// of each of those nodes is a flagged leaf; all of them are unlinked now
+	// except keep.
+	void retire_chain(int v, BST_NODE* node, BST_NODE* parent, BST_NODE* keep)
+	{
+		while (node != parent) {
+			auto& next = node->child(v);
+			auto& other = (&next == &node->left) ? node->right : node->left;
+			ebr.deleteNode(BST_EDGE::ptr(other.load()));
+			ebr.deleteNode(node);
+			node = BST_EDGE::ptr(next.load());
+		}
+
+		auto l = BST_EDGE::ptr(parent->left.load());
+		ebr.deleteNode(l == keep ? BST_EDGE::ptr(parent->right.load()) : l);
+		ebr.deleteNode(parent);
+	}
+
+	static void destroy(BST_NODE* root)
+	{
+		std::vector<BST_NODE*> stack{ root };
+		while (not stack.empty()) {
+			auto node = stack.back();
+			stack.pop_back();
+			if (auto l = BST_EDGE::ptr(node->left.load())) stack.push_back(l);
+			if (auto r = BST_EDGE::ptr(node->right.load())) stack.push_back(r);
+			delete node;
+		}
+	}
+
+private:
+	BST_NODE* R;
+	BST_NODE* S;
+
+	BasicEBR<BST_NODE> ebr;
+};
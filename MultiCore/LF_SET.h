@@ -0,0 +1,465 @@
+#pragma once
+
+#include <iostream>
+#include <atomic>
+#include <limits>
+#include <vector>
+#include <queue>
+#include <new>
+
+#include "Common.h"
+#include "OpStats.h"
+
+template <class NODE>
+class BasicAMR { // Atomic Markable Reference
+	volatile long long ptr_and_mark;
+public:
+	BasicAMR(NODE* ptr = nullptr, bool mark = false)
+	{
+		long long val = reinterpret_cast<long long>(ptr);
+		if (mark) val |= 1;
+		ptr_and_mark = val;
+	}
+
+	NODE* GetPtr()
+	{
+		long long val = ptr_and_mark;
+		return reinterpret_cast<NODE*>(val & ~1ULL);
+	}
+
+	bool GetMark()
+	{
+		return (ptr_and_mark & 1) == 1;
+	}
+
+	NODE* GetPtrAndMark(bool* mark)
+	{
+		long long val = ptr_and_mark;
+		*mark = (val & 1) == 1;
+		return reinterpret_cast<NODE*>(val & ~1ULL);
+	}
+
+	bool AttemptMark(NODE* expected_ptr, bool new_mark)
+	{
+		return CAS(expected_ptr, expected_ptr, false, new_mark);
+	}
+
+	bool CAS(NODE* expected_ptr, NODE* new_ptr, bool expected_mark, bool new_mark)
+	{
+		long long expected_val = reinterpret_cast<long long>(expected_ptr);
+		if (expected_mark) expected_val |= 1;
+
+		long long new_val = reinterpret_cast<long long>(new_ptr);
+		if (new_mark) new_val |= 1;	
+
+		return std::atomic_compare_exchange_strong(
+			reinterpret_cast<volatile std::atomic<long long>*>(&ptr_and_mark),
+			&expected_val, new_val);
+	}
+};
+
+class LF_NODE;
+using AMR = BasicAMR<LF_NODE>;
+
+class LF_NODE {
+public:
+	int value;
+	AMR next;
+	int epoch; // For EBR
+
+	LF_NODE(int v) : value(v), epoch(0) {}
+};
+
+template <class NODE>
+class BasicEBR { // Epoch Based Reclamation
+	struct ThreadCounter {
+		alignas(64) std::atomic<int> localEpoch;
+	};
+
+public:
+	~BasicEBR()
+	{
+		recycle();
+	}
+
+public:
+	void recycle()
+	{
+		for (int i = 0; i < MAX_THREADS; ++i) {
+			while (not freeList[i].empty()) {
+				auto node = freeList[i].front();
+				freeList[i].pop();
+				delete node;
+			}
+		}
+	}
+
+	// A recycled node is destroyed and constructed again from args.
+	template <class... ARGS>
+	NODE* newNode(ARGS... args)
+	{
+		if (not freeList[threadId].empty()) {
+			auto node = freeList[threadId].front();
+
+			bool canReuse{ true };
+			for (int i = 0; i < num_thread; ++i) {
+				if (i == threadId) continue;
+				if (threadCounter[i].localEpoch <= node->epoch) {
+					canReuse = false;
+					break;
+				}
+			}
+
+			if (canReuse) {
+				freeList[threadId].pop();
+				node->~NODE();
+				return new (node) NODE(args...);
+			}
+		}
+
+		return new NODE(args...);
+	}
+
+	void deleteNode(NODE* node)
+	{
+		node->epoch = epochCounter;
+		freeList[threadId].push(node);
+	}
+
+	void StartOp()
+	{
+		threadCounter[threadId].localEpoch = epochCounter.fetch_add(1);
+	}
+
+	// StartOp() for readers that must not write shared memory: publishes the
+	// current epoch without advancing it. The writers' StartOp() keeps the
+	// epoch moving so that retired nodes still become reusable.
+	void StartRead()
+	{
+		threadCounter[threadId].localEpoch = epochCounter.load();
+	}
+
+	void EndOp()
+	{
+		threadCounter[threadId].localEpoch = std::numeric_limits<int>::max();
+	}
+
+private:
+	std::queue<NODE*> freeList[MAX_THREADS];
+	std::atomic<int> epochCounter{ 0 };
+	ThreadCounter threadCounter[MAX_THREADS];
+};
+
+using EBR = BasicEBR<LF_NODE>;
+
+class LF_SET {
+public:
+	LF_SET()
+	{
+		head = new LF_NODE(std::numeric_limits<int>::min());
+		tail = new LF_NODE(std::numeric_limits<int>::max());
+		head->next = tail;
+	}
+
+	~LF_SET()
+	{
+		clear();
+		delete head;
+		delete tail;
+	}
+
+	void clear()
+	{
+		LF_NODE* curr = head->next.GetPtr();
+
+		while (curr != tail) {
+			LF_NODE* temp = curr;
+			curr = curr->next.GetPtr();
+			delete temp;
+		}
+
+		head->next = tail;
+	}
+
+	bool add(int v)
+	{
+		while (true) {
+			LF_NODE* prev{ nullptr };
+			LF_NODE* curr{ nullptr };
+			find(prev, curr, v);
+
+			if (curr->value == v) {
+				return false;
+			}
+
+			else {
+				auto newNode = new LF_NODE(v);
+				newNode->next = curr;
+				if (prev->next.CAS(curr, newNode, false, false)) {
+					return true;
+				}
+				STAT_INC(STAT_CAS_FAIL);
+				delete newNode;
+			}
+		}
+	}
+
+	bool remove(int v)
+	{
+		while (true) {
+			LF_NODE* prev{ nullptr };
+			LF_NODE* curr{ nullptr };
+			find(prev, curr, v);
+
+			if (curr->value != v) {
+				return false;
+			}
+
+			else {
+				LF_NODE* succ = curr->next.GetPtr();
+				if(not curr->next.AttemptMark(succ, true)) {
+					STAT_INC(STAT_MARK_FAIL);
+					continue;
+				}
+
+				if (not prev->next.CAS(curr, succ, false, false)) {
+					STAT_INC(STAT_CAS_FAIL);
+				}
+				return true;
+			}
+		}
+	}
+
+	bool contains(int v)
+	{
+		LF_NODE* curr = head;
+
+		while (curr->value < v) {
+			STAT_INC(STAT_TRAVERSED);
+			curr = curr->next.GetPtr();
+		}
+
+		return curr->value == v and not curr->next.GetMark();
+	}
+
+	void print20()
+	{
+		auto curr = head->next.GetPtr();
+
+		for (int i = 0; i < 20 and curr != tail; ++i) {
+			std::cout << curr->value << ", ";
+			curr = curr->next.GetPtr();
+		}
+		std::cout << std::endl;
+	}
+
+private:
+	void find(LF_NODE*& prev, LF_NODE*& curr, int v)
+	{
+		while (true) {
+			retry:
+			prev = head;
+			curr = prev->next.GetPtr();
+
+			while (true) {
+				bool currMark;
+				auto succ = curr->next.GetPtrAndMark(&currMark);
+
+				while (currMark) {
+					if (not prev->next.CAS(curr, succ, false, false)) {
+						STAT_INC(STAT_CAS_FAIL);
+						STAT_INC(STAT_RESTART);
+						goto retry;
+					}
+
+					curr = succ;
+					succ = curr->next.GetPtrAndMark(&currMark);
+				}
+
+				if (curr->value >= v) {
+					return;
+				}
+
+				STAT_INC(STAT_TRAVERSED);
+				prev = curr;
+				curr = succ;
+			}
+		}
+	}
+
+private:
+	LF_NODE* head;
+	LF_NODE* tail;
+};
+
+class LF_SET_EBR {
+public:
+	LF_SET_EBR()
+	{
+		head = new LF_NODE(std::numeric_limits<int>::min());
+		tail = new LF_NODE(std::numeric_limits<int>::max());
+		head->next = tail;
+	}
+
+	~LF_SET_EBR()
+	{
+		clear();
+		delete head;
+		delete tail;
+	}
+
+	void clear()
+	{
+		LF_NODE* curr = head->next.GetPtr();
+
+		while (curr != tail) {
+			LF_NODE* temp = curr;
+			curr = curr->next.GetPtr();
+			delete temp;
+		}
+
+		head->next = tail;
+	}
+
+	bool add(int v)
+	{
+		ebr.StartOp();
+
+		while (true) {
+			LF_NODE* prev{ nullptr };
+			LF_NODE* curr{ nullptr };
+			find(prev, curr, v);
+
+			if (curr->value == v) {
+				ebr.EndOp();
+				return false;
+			}
+
+			else {
+				auto newNode = ebr.newNode(v);
+				newNode->next = curr;
+				if (prev->next.CAS(curr, newNode, false, false)) {
+					ebr.EndOp();
+					return true;
+				}
+				STAT_INC(STAT_CAS_FAIL);
+				ebr.deleteNode(newNode);
+			}
+		}
+	}
+
+	bool remove(int v)
+	{
+		ebr.StartOp();
+
+		while (true) {
+			LF_NODE* prev{ nullptr };
+			LF_NODE* curr{ nullptr };
+			find(prev, curr, v);
+
+			if (curr->value != v) {
+				ebr.EndOp();
+				return false;
+			}
+
+			else {
+				LF_NODE* succ = curr->next.GetPtr();
+				if (not curr->next.AttemptMark(succ, true)) {
+					STAT_INC(STAT_MARK_FAIL);
+					continue;
+				}
+
+				if (prev->next.CAS(curr, succ, false, false)) {
+					ebr.deleteNode(curr);
+				}
+				else {
+					STAT_INC(STAT_CAS_FAIL);
+				}
+
+				ebr.EndOp();
+				return true;
+			}
+		}
+	}
+
+	bool contains(int v)
+	{
+		ebr.StartOp();
+
+		LF_NODE* curr = head;
+
+		while (curr->value < v) {
+			STAT_INC(STAT_TRAVERSED);
+			curr = curr->next.GetPtr();
+		}
+
+		bool result = curr->value == v and not curr->next.GetMark();
+
+		ebr.EndOp();
+		return result;
+	}
+
+	void print20()
+	{
+		auto curr = head->next.GetPtr();
+
+		for (int i = 0; i < 20 and curr != tail; ++i) {
+			std::cout << curr->value << ", ";
+			curr = curr->next.GetPtr();
+		}
+		std::cout << std::endl;
+	}
+
+	// Appends the keys in [lo, hi) in ascending order, skipping marked nodes
+	// that are still linked. Only while no operation is in flight.
+	void keys_in(int lo, int hi, std::vector<int>& keys)
+	{
+		auto curr = head->next.GetPtr();
+		while (curr->value < lo) curr = curr->next.GetPtr();
+
+		for (; curr != tail and curr->value < hi; curr = curr->next.GetPtr()) {
+			if (not curr->next.GetMark()) keys.push_back(curr->value);
+		}
+	}
+
+private:
+	void find(LF_NODE*& prev, LF_NODE*& curr, int v)
+	{
+		while (true) {
+		retry:
+			prev = head;
+			curr = prev->next.GetPtr();
+
+			while (true) {
+				bool currMark;
+				auto succ = curr->next.GetPtrAndMark(&currMark);
+
+				while (currMark) {
+					if (not prev->next.CAS(curr, succ, false, false)) {
+						STAT_INC(STAT_CAS_FAIL);
+						STAT_INC(STAT_RESTART);
+						goto retry;
+					}
+
+					ebr.deleteNode(curr);
+					curr = succ;
+					succ = curr->next.GetPtrAndMark(&currMark);
+				}
+
+				if (curr->value >= v) {
+					return;
+				}
+
+				STAT_INC(STAT_TRAVERSED);
+				prev = curr;
+				curr = succ;
+			}
+		}
+	}
+
+private:
+	LF_NODE* head;
+	LF_NODE* tail;
+
+	EBR ebr;
+};
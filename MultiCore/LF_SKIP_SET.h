@@ -0,0 +1,250 @@
+#pragma once
+
+#include <iostream>
+#include <atomic>
+#include <limits>
+
+#include "Common.h"
+#include "OpStats.h"
+#include "LF_SET.h"
+#include "SkipLevel.h"
+
+// Lock-free skiplist (Herlihy & Shavit, "The Art of Multiprocessor Programming"
+// 14.4) on the same marked references as LF_SET, with EBR for reclamation.
+// The bottom level is the set; the levels above are shortcuts.
+
+class LF_SKIP_NODE;
+using SKIP_AMR = BasicAMR<LF_SKIP_NODE>;
+
+class LF_SKIP_NODE {
+public:
+	int value;
+	int top; // highest level this node is linked on
+	SKIP_AMR* next;
+	int epoch; // For EBR
+
+	// Both add (while it links the upper levels) and remove (until the node is
+	// unlinked everywhere) hold a reference; the last one to let go retires it.
+	std::atomic<int> owners;
+
+	LF_SKIP_NODE(int v, int top) : value(v), top(top), next(new SKIP_AMR[top + 1]), epoch(0), owners(2) {}
+	~LF_SKIP_NODE() { delete[] next; }
+};
+
+class LF_SKIP_SET {
+public:
+	LF_SKIP_SET()
+	{
+		head = new LF_SKIP_NODE(std::numeric_limits<int>::min(), SKIP_LEVELS - 1);
+		tail = new LF_SKIP_NODE(std::numeric_limits<int>::max(), SKIP_LEVELS - 1);
+		for (int level = 0; level < SKIP_LEVELS; ++level) head->next[level] = tail;
+	}
+
+	~LF_SKIP_SET()
+	{
+		clear();
+		delete head;
+		delete tail;
+	}
+
+	void clear()
+	{
+		LF_SKIP_NODE* curr = head->next[0].GetPtr();
+
+		while (curr != tail) {
+			LF_SKIP_NODE* temp = curr;
+			curr = curr->next[0].GetPtr();
+			delete temp;
+		}
+
+		for (int level = 0; level < SKIP_LEVELS; ++level) head->next[level] = tail;
+	}
+
+	bool add(int v)
+	{
+		LF_SKIP_NODE* preds[SKIP_LEVELS];
+		LF_SKIP_NODE* succs[SKIP_LEVELS];
+		LF_SKIP_NODE* newNode{ nullptr };
+
+		ebr.StartOp();
+
+		while (true) {
+			if (find(v, preds, succs)) {
+				if (newNode) ebr.deleteNode(newNode);
+				ebr.EndOp();
+				return false;
+			}
+
+			if (newNode == nullptr) newNode = ebr.newNode(v, random_skip_level());
+			for (int level = 0; level <= newNode->top; ++level) newNode->next[level] = succs[level];
+
+			if (preds[0]->next[0].CAS(succs[0], newNode, false, false)) break;
+			STAT_INC(STAT_CAS_FAIL);
+		}
+
+		// The node is in the set. Link it on the upper levels unless a remove
+		// has started marking it.
+		for (int level = 1; level <= newNode->top; ++level) {
+			while (true) {
+				bool mark;
+				auto next = newNode->next[level].GetPtrAndMark(&mark);
+				if (mark) goto linked;
+				if (next != succs[level] and not newNode->next[level].CAS(next, succs[level], false, false)) goto linked;
+
+				if (preds[level]->next[level].CAS(succs[level], newNode, false, false)) break;
+				STAT_INC(STAT_CAS_FAIL);
+
+				find(v, preds, succs);
+				if (succs[0] != newNode) goto linked;
+			}
+		}
+
+	linked:
+		// a remove may have cleaned up before the last link went in
+		if (newNode->next[0].GetMark()) find(v, preds, succs);
+		release(newNode);
+
+		ebr.EndOp();
+		return true;
+	}
+
+	bool remove(int v)
+	{
+		LF_SKIP_NODE* preds[SKIP_LEVELS];
+		LF_SKIP_NODE* succs[SKIP_LEVELS];
+
+		ebr.StartOp();
+
+		if (false == find(v, preds, succs)) {
+			ebr.EndOp();
+			return false;
+		}
+
+		LF_SKIP_NODE* victim = succs[0];
+		for (int level = victim->top; level >= 1; --level) {
+			bool mark;
+			auto succ = victim->next[level].GetPtrAndMark(&mark);
+			while (not mark) {
+				if (not victim->next[level].AttemptMark(succ, true)) STAT_INC(STAT_MARK_FAIL);
+				succ = victim->next[level].GetPtrAndMark(&mark);
+			}
+		}
+
+		// whoever marks the bottom level removed the value
+		bool mark;
+		auto succ = victim->next[0].GetPtrAndMark(&mark);
+		while (true) {
+			bool marked_by_me = victim->next[0].AttemptMark(succ, true);
+			succ = victim->next[0].GetPtrAndMark(&mark);
+
+			if (marked_by_me) {
+				find(v, preds, succs);
+				release(victim);
+				ebr.EndOp();
+				return true;
+			}
+
+			if (mark) {
+				ebr.EndOp();
+				return false;
+			}
+			STAT_INC(STAT_MARK_FAIL);
+		}
+	}
+
+	bool contains(int v)
+	{
+		ebr.StartOp();
+
+		LF_SKIP_NODE* pred = head;
+		LF_SKIP_NODE* curr{ nullptr };
+
+		for (int level = SKIP_LEVELS - 1; level >= 0; --level) {
+			curr = pred->next[level].GetPtr();
+
+			while (true) {
+				bool mark;
+				auto succ = curr->next[level].GetPtrAndMark(&mark);
+				while (mark) {
+					curr = succ;
+					succ = curr->next[level].GetPtrAndMark(&mark);
+				}
+
+				if (curr->value >= v) break;
+
+				STAT_INC(STAT_TRAVERSED);
+				pred = curr;
+				curr = succ;
+			}
+		}
+
+		bool result = curr->value == v;
+
+		ebr.EndOp();
+		return result;
+	}
+
+	void print20()
+	{
+		auto curr = head->next[0].GetPtr();
+
+		for (int i = 0; i < 20 and curr != tail; ++i) {
+			std::cout << curr->value << ", ";
+			curr = curr->next[0].GetPtr();
+		}
+		std::cout << std::endl;
+	}
+
+private:
+	// Fills preds / succs on every level and unlinks the marked nodes on the
+	// way. Returns whether v is in the bottom level.
+	bool find(int v, LF_SKIP_NODE* preds[], LF_SKIP_NODE* succs[])
+	{
+		while (true) {
+		retry:
+			LF_SKIP_NODE* pred = head;
+
+			for (int level = SKIP_LEVELS - 1; level >= 0; --level) {
+				LF_SKIP_NODE* curr = pred->next[level].GetPtr();
+
+				while (true) {
+					bool currMark;
+					auto succ = curr->next[level].GetPtrAndMark(&currMark);
+
+					while (currMark) {
+						if (not pred->next[level].CAS(curr, succ, false, false)) {
+							STAT_INC(STAT_CAS_FAIL);
+							STAT_INC(STAT_RESTART);
+							goto retry;
+						}
+
+						curr = succ;
+						succ = curr->next[level].GetPtrAndMark(&currMark);
+					}
+
+					if (curr->value >= v) break;
+
+					STAT_INC(STAT_TRAVERSED);
+					pred = curr;
+					curr = succ;
+				}
+
+				preds[level] = pred;
+				succs[level] = curr;
+			}
+
+			return succs[0]->value == v;
+		}
+	}
+
+	void release(LF_SKIP_NODE* node)
+	{
+		if (node->owners.fetch_sub(1) == 1) ebr.deleteNode(node);
+	}
+
+private:
+	LF_SKIP_NODE* head;
+	LF_SKIP_NODE* tail;
+
+	BasicEBR<LF_SKIP_NODE> ebr;
+};
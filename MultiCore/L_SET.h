@@ -0,0 +1,655 @@
+#pragma once
+
+#include <iostream>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <limits>
+#include <vector>
+#include <queue>
+
+#include "Common.h"
+#include "OpStats.h"
+
+#if defined(__linux__)
+#include <unistd.h>
+#undef L_SET // <unistd.h> defines L_SET as an alias of SEEK_SET
+#endif
+
+class L_NODE {
+public:
+	int value;
+	volatile bool removed;
+	L_NODE* volatile next;
+	std::mutex mtx;
+
+	L_NODE(int v) 
+		: next(nullptr), value(v), removed(false) {}
+
+	void lock() { mtx.lock(); }
+	void unlock() { mtx.unlock(); }
+};
+
+class NODE_SP {
+public:
+	int value;
+	volatile bool removed;
+	std::shared_ptr<NODE_SP> next;
+	std::mutex mtx;
+
+	NODE_SP(int v)
+		: next(nullptr), value(v), removed(false) {
+	}
+
+	void lock() { mtx.lock(); }
+	void unlock() { mtx.unlock(); }
+};
+
+class NODE_ATOMIC_SP {
+public:
+	int value;
+	volatile bool removed;
+	std::atomic<std::shared_ptr<NODE_ATOMIC_SP>> next;
+	std::mutex mtx;
+
+	NODE_ATOMIC_SP(int v)
+		: next(nullptr), value(v), removed(false) {
+	}
+
+	void lock() { mtx.lock(); }
+	void unlock() { mtx.unlock(); }
+};
+
+class L_SET {
+public:
+	L_SET()
+	{
+		head = new L_NODE(std::numeric_limits<int>::min());
+		tail = new L_NODE(std::numeric_limits<int>::max());
+		head->next = tail;
+	}
+
+	~L_SET()
+	{
+		clear();
+		delete head;
+		delete tail;
+	}
+
+	void clear()
+	{
+		L_NODE* curr = head->next;
+
+		while (curr != tail) {
+			L_NODE* temp = curr;
+			curr = curr->next;
+			delete temp;
+		}
+
+		head->next = tail;
+	}
+
+	bool add(int v)
+	{
+		while (true) {
+			auto prev = head;
+			auto curr = prev->next;
+
+			while (curr->value < v) {
+				STAT_INC(STAT_TRAVERSED);
+				prev = curr;
+				curr = curr->next;
+			}
+
+			prev->lock();
+			curr->lock();
+			if (false == validate(prev, curr)) {
+				STAT_INC(STAT_VALIDATE_FAIL);
+				prev->unlock();
+				curr->unlock();
+				continue;
+			}
+
+			if (curr->value == v) {
+				prev->unlock();
+				curr->unlock();
+
+				return false;
+			}
+
+			else {
+				auto newNode = new L_NODE(v);
+				newNode->next = curr;
+				prev->next = newNode;
+
+				prev->unlock();
+				curr->unlock();
+
+				return true;
+			}
+		}
+	}
+
+	bool remove(int v)
+	{
+		while (true) {
+			auto prev = head;
+			auto curr = prev->next;
+
+			while (curr->value < v) {
+				STAT_INC(STAT_TRAVERSED);
+				prev = curr;
+				curr = curr->next;
+			}
+
+			prev->lock();
+			curr->lock();
+			if (false == validate(prev, curr)) {
+				STAT_INC(STAT_VALIDATE_FAIL);
+				prev->unlock();
+				curr->unlock();
+				continue;
+			}
+
+			if (curr->value == v) {
+				curr->removed = true;
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				prev->next = curr->next;
+
+				prev->unlock();
+				curr->unlock();
+
+				return true;
+			}
+
+			else {
+				prev->unlock();
+				curr->unlock();
+
+				return false;
+			}
+		}
+	}
+
+	bool contains(int v)
+	{
+		L_NODE* curr = head;
+
+		while (curr->value < v) {
+			STAT_INC(STAT_TRAVERSED);
+			curr = curr->next;
+		}
+
+		return curr->value == v and not curr->removed;
+	}
+
+	void print20()
+	{
+		auto curr = head->next;
+
+		for (int i = 0; i < 20 and curr != tail; ++i) {
+			std::cout << curr->value << ", ";
+			curr = curr->next;
+		}
+		std::cout << std::endl;
+	}
+
+	// Appends the keys in [lo, hi) in ascending order. Only while no
+	// operation is in flight.
+	void keys_in(int lo, int hi, std::vector<int>& keys)
+	{
+		auto curr = head->next;
+		while (curr->value < lo) curr = curr->next;
+
+		for (; curr != tail and curr->value < hi; curr = curr->next) {
+			if (not curr->removed) keys.push_back(curr->value);
+		}
+	}
+
+private:
+	bool validate(L_NODE* p, L_NODE* c)
+	{
+		return (p->removed == false)
+			and (c->removed == false)
+			and (p->next == c);
+	}
+
+private:
+	L_NODE* head;
+	L_NODE* tail;
+};
+
+class L_SET_FL {
+public:
+	L_SET_FL()
+	{
+		head = new L_NODE(std::numeric_limits<int>::min());
+		tail = new L_NODE(std::numeric_limits<int>::max());
+		head->next = tail;
+	}
+
+	~L_SET_FL()
+	{
+		clear();
+		delete head;
+		delete tail;
+	}
+
+	void my_delete(L_NODE* node)
+	{
+		std::lock_guard<std::mutex> lg{ fl_mtx };
+		free_list.push(node);
+	}
+
+	void recycle()
+	{
+		while (false == free_list.empty()) {
+			auto node = free_list.front();
+			free_list.pop();
+			delete node;
+		}
+	}
+
+	void clear()
+	{
+		L_NODE* curr = head->next;
+
+		while (curr != tail) {
+			L_NODE* temp = curr;
+			curr = curr->next;
+			delete temp;
+		}
+
+		head->next = tail;
+	}
+
+	bool add(int v)
+	{
+		while (true) {
+			auto prev = head;
+			auto curr = prev->next;
+
+			while (curr->value < v) {
+				STAT_INC(STAT_TRAVERSED);
+				prev = curr;
+				curr = curr->next;
+			}
+
+			prev->lock();
+			curr->lock();
+			if (false == validate(prev, curr)) {
+				STAT_INC(STAT_VALIDATE_FAIL);
+				prev->unlock();
+				curr->unlock();
+				continue;
+			}
+
+			if (curr->value == v) {
+				prev->unlock();
+				curr->unlock();
+
+				return false;
+			}
+
+			else {
+				auto newNode = new L_NODE(v);
+				newNode->next = curr;
+				prev->next = newNode;
+
+				prev->unlock();
+				curr->unlock();
+
+				return true;
+			}
+		}
+	}
+
+	bool remove(int v)
+	{
+		while (true) {
+			auto prev = head;
+			auto curr = prev->next;
+
+			while (curr->value < v) {
+				STAT_INC(STAT_TRAVERSED);
+				prev = curr;
+				curr = curr->next;
+			}
+
+			prev->lock();
+			curr->lock();
+			if (false == validate(prev, curr)) {
+				STAT_INC(STAT_VALIDATE_FAIL);
+				prev->unlock();
+				curr->unlock();
+				continue;
+			}
+
+			if (curr->value == v) {
+				curr->removed = true;
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				prev->next = curr->next;
+				my_delete(curr);
+
+				prev->unlock();
+				curr->unlock();
+
+				return true;
+			}
+
+			else {
+				prev->unlock();
+				curr->unlock();
+
+				return false;
+			}
+		}
+	}
+
+	bool contains(int v)
+	{
+		L_NODE* curr = head;
+
+		while (curr->value < v) {
+			STAT_INC(STAT_TRAVERSED);
+			curr = curr->next;
+		}
+
+		return curr->value == v and not curr->removed;
+	}
+
+	void print20()
+	{
+		auto curr = head->next;
+
+		for (int i = 0; i < 20 and curr != tail; ++i) {
+			std::cout << curr->value << ", ";
+			curr = curr->next;
+		}
+		std::cout << std::endl;
+	}
+
+private:
+	bool validate(L_NODE* p, L_NODE* c)
+	{
+		return (p->removed == false)
+			and (c->removed == false)
+			and (p->next == c);
+	}
+
+private:
+	L_NODE* head;
+	L_NODE* tail;
+	std::queue<L_NODE*> free_list;
+	std::mutex fl_mtx;
+};
+
+class L_SET_SP {
+public:
+	L_SET_SP()
+	{
+		head = std::make_shared<NODE_SP>(std::numeric_limits<int>::min());
+		tail = std::make_shared<NODE_SP>(std::numeric_limits<int>::max());
+		head->next = tail;
+	}
+
+	~L_SET_SP() = default;
+
+	void clear()
+	{
+		head->next = tail;
+	}
+
+	bool add(int v)
+	{
+		while (true) {
+			auto prev = head;
+			auto curr = prev->next;
+
+			while (curr->value < v) {
+				STAT_INC(STAT_TRAVERSED);
+				prev = curr;
+				curr = curr->next;
+			}
+
+			prev->lock();
+			curr->lock();
+			if (false == validate(prev, curr)) {
+				STAT_INC(STAT_VALIDATE_FAIL);
+				prev->unlock();
+				curr->unlock();
+				continue;
+			}
+
+			if (curr->value == v) {
+				prev->unlock();
+				curr->unlock();
+
+				return false;
+			}
+
+			else {
+				auto newNode = std::make_shared<NODE_SP>(v);
+				newNode->next = curr;
+				prev->next = newNode;
+
+				prev->unlock();
+				curr->unlock();
+
+				return true;
+			}
+		}
+	}
+
+	bool remove(int v)
+	{
+		while (true) {
+			auto prev = head;
+			auto curr = prev->next;
+
+			while (curr->value < v) {
+				STAT_INC(STAT_TRAVERSED);
+				prev = curr;
+				curr = curr->next;
+			}
+
+			prev->lock();
+			curr->lock();
+			if (false == validate(prev, curr)) {
+				STAT_INC(STAT_VALIDATE_FAIL);
+				prev->unlock();
+				curr->unlock();
+				continue;
+			}
+
+			if (curr->value == v) {
+				curr->removed = true;
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				prev->next = curr->next;
+
+				prev->unlock();
+				curr->unlock();
+
+				return true;
+			}
+
+			else {
+				prev->unlock();
+				curr->unlock();
+
+				return false;
+			}
+		}
+	}
+
+	bool contains(int v)
+	{
+		auto curr = head->next;
+
+		while (curr->value < v) {
+			STAT_INC(STAT_TRAVERSED);
+			curr = curr->next;
+		}
+
+		return curr->value == v and not curr->removed;
+	}
+
+	void print20()
+	{
+		auto curr = head->next;
+
+		for (int i = 0; i < 20 and curr != tail; ++i) {
+			std::cout << curr->value << ", ";
+			curr = curr->next;
+		}
+		std::cout << std::endl;
+	}
+
+private:
+	bool validate(const std::shared_ptr<NODE_SP>& p, 
+		const std::shared_ptr<NODE_SP>& c)
+	{
+		return (p->removed == false)
+			and (c->removed == false)
+			and (p->next == c);
+	}
+
+private:
+	std::shared_ptr<NODE_SP> head;
+	std::shared_ptr<NODE_SP> tail;
+};
+
+class L_SET_ATOMIC_SP {
+public:
+	L_SET_ATOMIC_SP()
+	{
+		head = std::make_shared<NODE_ATOMIC_SP>(std::numeric_limits<int>::min());
+		tail = std::make_shared<NODE_ATOMIC_SP>(std::numeric_limits<int>::max());
+		head->next = tail;
+	}
+
+	~L_SET_ATOMIC_SP() = default;
+
+	void clear()
+	{
+		head->next = tail;
+	}
+
+	bool add(int v)
+	{
+		while (true) {
+			auto prev = head;
+			auto curr = prev->next.load();
+
+			while (curr->value < v) {
+				STAT_INC(STAT_TRAVERSED);
+				prev = curr;
+				curr = curr->next;
+			}
+
+			prev->lock();
+			curr->lock();
+			if (false == validate(prev, curr)) {
+				STAT_INC(STAT_VALIDATE_FAIL);
+				prev->unlock();
+				curr->unlock();
+				continue;
+			}
+
+			if (curr->value == v) {
+				prev->unlock();
+				curr->unlock();
+
+				return false;
+			}
+
+			else {
+				auto newNode = std::make_shared<NODE_ATOMIC_SP>(v);
+				newNode->next = curr;
+				prev->next = newNode;
+
+				prev->unlock();
+				curr->unlock();
+
+				return true;
+			}
+		}
+	}
+
+	bool remove(int v)
+	{
+		while (true) {
+			auto prev = head;
+			auto curr = prev->next.load();
+
+			while (curr->value < v) {
+				STAT_INC(STAT_TRAVERSED);
+				prev = curr;
+				curr = curr->next;
+			}
+
+			prev->lock();
+			curr->lock();
+			if (false == validate(prev, curr)) {
+				STAT_INC(STAT_VALIDATE_FAIL);
+				prev->unlock();
+				curr->unlock();
+				continue;
+			}
+
+			if (curr->value == v) {
+				curr->removed = true;
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				prev->next = curr->next.load();
+
+				prev->unlock();
+				curr->unlock();
+
+				return true;
+			}
+
+			else {
+				prev->unlock();
+				curr->unlock();
+
+				return false;
+			}
+		}
+	}
+
+	bool contains(int v)
+	{
+		auto curr = head->next.load();
+
+		while (curr->value < v) {
+			STAT_INC(STAT_TRAVERSED);
+			curr = curr->next;
+		}
+
+		return curr->value == v and not curr->removed;
+	}
+
+	void print20()
+	{
+		auto curr = head->next.load();
+
+		for (int i = 0; i < 20 and curr != tail; ++i) {
+			std::cout << curr->value << ", ";
+			curr = curr->next;
+		}
+		std::cout << std::endl;
+	}
+
+private:
+	bool validate(const std::shared_ptr<NODE_ATOMIC_SP>& p,
+		const std::shared_ptr<NODE_ATOMIC_SP>& c)
+	{
+		return (p->removed == false)
+			and (c->removed == false)
+			and (p->next.load() == c);
+	}
+
+private:
+	std::shared_ptr<NODE_ATOMIC_SP> head;
+	std::shared_ptr<NODE_ATOMIC_SP> tail;
+};
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <iostream>
+#include <mutex>
+#include <atomic>
+#include <limits>
+
+#include "Common.h"
+#include "OpStats.h"
+#include "SkipLevel.h"
+#include "LF_SET.h"
+
+// Lazy skiplist (Herlihy, Lev, Luchangco & Shavit, "A Simple Optimistic
+// Skiplist Algorithm"). Writers lock the predecessors on every level and
+// validate like L_SET; contains() takes no locks. A node is in the set once
+// it is fullyLinked and until it is marked. Removed nodes go back through EBR,
+// since contains() may still be standing on them.
+class L_SKIP_NODE {
+public:
+	int value;
+	int top; // highest level this node is linked on
+	std::atomic<L_SKIP_NODE*>* next;
+	std::atomic<bool> marked;
+	std::atomic<bool> fullyLinked;
+	std::mutex mtx;
+	int epoch; // For EBR
+
+	L_SKIP_NODE(int v, int top)
+		: value(v), top(top), next(new std::atomic<L_SKIP_NODE*>[top + 1]), marked(false), fullyLinked(false), epoch(0) {}
+	~L_SKIP_NODE() { delete[] next; }
+
+	void lock() { mtx.lock(); }
+	void unlock() { mtx.unlock(); }
+};
+
+class L_SKIP_SET {
+public:
+	L_SKIP_SET()
+	{
+		head = new L_SKIP_NODE(std::numeric_limits<int>::min(), SKIP_LEVELS - 1);
+		tail = new L_SKIP_NODE(std::numeric_limits<int>::max(), SKIP_LEVELS - 1);
+		for (int level = 0; level < SKIP_LEVELS; ++level) head->next[level] = tail;
+		head->fullyLinked = true;
+		tail->fullyLinked = true;
+	}
+
+	~L_SKIP_SET()
+	{
+		clear();
+		delete head;
+		delete tail;
+	}
+
+	void clear()
+	{
+		L_SKIP_NODE* curr = head->next[0];
+
+		while (curr != tail) {
+			L_SKIP_NODE* temp = curr;
+			curr = curr->next[0];
+			delete temp;
+		}
+
+		for (int level = 0; level < SKIP_LEVELS; ++level) head->next[level] = tail;
+		ebr.recycle();
+	}
+
+	bool add(int v)
+	{
+		L_SKIP_NODE* preds[SKIP_LEVELS];
+		L_SKIP_NODE* succs[SKIP_LEVELS];
+		const int top = random_skip_level();
+
+		ebr.StartOp();
+
+		while (true) {
+			int found = find(v, preds, succs);
+			if (found != -1) {
+				L_SKIP_NODE* node = succs[found];
+				if (not node->marked) {
+					// v is being added by someone else; it counts once linked
+					while (not node->fullyLinked);
+					ebr.EndOp();
+					return false;
+				}
+				continue;
+			}
+
+			int highest;
+			if (false == lock_preds(preds, succs, top, nullptr, highest)) {
+				STAT_INC(STAT_VALIDATE_FAIL);
+				unlock_preds(preds, highest);
+				continue;
+			}
+
+			auto newNode = ebr.newNode(v, top);
+			for (int level = 0; level <= top; ++level) newNode->next[level] = succs[level];
+			for (int level = 0; level <= top; ++level) preds[level]->next[level] = newNode;
+			newNode->fullyLinked = true;
+
+			unlock_preds(preds, top);
+			ebr.EndOp();
+			return true;
+		}
+	}
+
+	bool remove(int v)
+	{
+		L_SKIP_NODE* preds[SKIP_LEVELS];
+		L_SKIP_NODE* succs[SKIP_LEVELS];
+		L_SKIP_NODE* victim{ nullptr };
+		bool isMarked{ false };
+
+		ebr.StartOp();
+
+		while (true) {
+			int found = find(v, preds, succs);
+			if (found != -1) victim = succs[found];
+
+			if (not isMarked) {
+				// only a node that is fully linked and found on its top level
+				// can be removed; anything else is still being added or removed
+				if (found == -1 or not victim->fullyLinked or victim->top != found or victim->marked) {
+					ebr.EndOp();
+					return false;
+				}
+
+				victim->lock();
+				if (victim->marked) {
+					victim->unlock();
+					ebr.EndOp();
+					return false;
+				}
+				victim->marked = true;
+				isMarked = true;
+			}
+
+			int highest;
+			if (false == lock_preds(preds, succs, victim->top, victim, highest)) {
+				STAT_INC(STAT_VALIDATE_FAIL);
+				unlock_preds(preds, highest);
+				continue;
+			}
+
+			for (int level = victim->top; level >= 0; --level) {
+				preds[level]->next[level] = victim->next[level].load();
+			}
+
+			victim->unlock();
+			unlock_preds(preds, victim->top);
+
+			ebr.deleteNode(victim);
+			ebr.EndOp();
+			return true;
+		}
+	}
+
+	bool contains(int v)
+	{
+		L_SKIP_NODE* preds[SKIP_LEVELS];
+		L_SKIP_NODE* succs[SKIP_LEVELS];
+
+		ebr.StartRead();
+		int found = find(v, preds, succs);
+		bool result = found != -1 and succs[found]->fullyLinked and not succs[found]->marked;
+		ebr.EndOp();
+		return result;
+	}
+
+	void print20()
+	{
+		auto curr = head->next[0].load();
+
+		for (int i = 0; i < 20 and curr != tail; ++i) {
+			std::cout << curr->value << ", ";
+			curr = curr->next[0];
+		}
+		std::cout << std::endl;
+	}
+
+private:
+	// Highest level on which v was found, or -1. Takes no locks.
+	int find(int v, L_SKIP_NODE* preds[], L_SKIP_NODE* succs[])
+	{
+		int found{ -1 };
+		L_SKIP_NODE* pred = head;
+
+		for (int level = SKIP_LEVELS - 1; level >= 0; --level) {
+			L_SKIP_NODE* curr = pred->next[level];
+
+			while (curr->value < v) {
+				STAT_INC(STAT_TRAVERSED);
+				pred = curr;
+				curr = pred->next[level];
+			}
+
+			if (found == -1 and curr->value == v) found = level;
+			preds[level] = pred;
+			succs[level] = curr;
+		}
+
+		return found;
+	}
+
+	// Locks the predecessors on levels 0..top (each node once; consecutive
+	// levels often share one) and validates them. For add, succ is the node
+	// that must follow; for remove, the victim. highest is the last level
+	// whose predecessor is locked, for unlock_preds().
+	bool lock_preds(L_SKIP_NODE* preds[], L_SKIP_NODE* succs[], int top, L_SKIP_NODE* victim, int& highest)
+	{
+		L_SKIP_NODE* prevPred{ nullptr };
+
+		for (int level = 0; level <= top; ++level) {
+			L_SKIP_NODE* pred = preds[level];
+			L_SKIP_NODE* succ = victim ? victim : succs[level];
+
+			if (pred != prevPred) {
+				pred->lock();
+				prevPred = pred;
+			}
+			highest = level;
+
+			bool valid = not pred->marked and pred->next[level] == succ;
+			if (victim == nullptr) valid = valid and not succ->marked;
+			if (not valid) return false;
+		}
+
+		return true;
+	}
+
+	void unlock_preds(L_SKIP_NODE* preds[], int highest)
+	{
+		L_SKIP_NODE* prevPred{ nullptr };
+
+		for (int level = 0; level <= highest; ++level) {
+			if (preds[level] != prevPred) {
+				preds[level]->unlock();
+				prevPred = preds[level];
+			}
+		}
+	}
+
+private:
+	L_SKIP_NODE* head;
+	L_SKIP_NODE* tail;
+
+	BasicEBR<L_SKIP_NODE> ebr;
+};
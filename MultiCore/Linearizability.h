@@ -0,0 +1,243 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <unordered_set>
+
+#include "Workload.h"
+
+struct EVENT {
+	unsigned long long invoke;
+	unsigned long long response;
+	int value;
+	int op;
+	bool result;
+};
+
+enum class LIN_RESULT { OK, VIOLATION, UNKNOWN };
+
+// Linearizability checker for set histories. A set is P-compositional: it is
+// linearizable iff the sub-history of every key is linearizable as a single
+// boolean register with add/remove/contains, so keys are checked independently
+// and in parallel. Each key's events are cut at quiescent points (no operation
+// pending) and the reachable states are carried from one segment to the next;
+// inside a segment a Wing & Gong search with a configuration cache
+// (Lowe, "Testing for linearizability") tries every legal order.
+class LinearizabilityChecker {
+public:
+	static constexpr size_t SEARCH_LIMIT{ 1 << 22 }; // configurations per segment
+
+	LIN_RESULT check(const std::vector<std::vector<EVENT>*>& histories,
+		const std::vector<int>& initial, int range, int num_threads, std::string& error)
+	{
+		// partition by key with a counting sort
+		std::vector<long long> offset(static_cast<size_t>(range) + 1, 0);
+		for (auto h : histories) {
+			for (auto& e : *h) offset[e.value + 1]++;
+		}
+		for (int v = 0; v < range; ++v) offset[v + 1] += offset[v];
+
+		std::vector<EVENT> events(offset[range]);
+		std::vector<long long> pos(offset.begin(), offset.end() - 1);
+		for (auto h : histories) {
+			for (auto& e : *h) events[pos[e.value]++] = e;
+		}
+
+		std::vector<char> present(range, 0);
+		for (int v : initial) present[v] = 1;
+
+		std::atomic<int> next_key{ 0 };
+		std::vector<LIN_RESULT> results(num_threads, LIN_RESULT::OK);
+		std::vector<std::string> errors(num_threads);
+		std::vector<std::thread> checkers;
+
+		for (int t = 0; t < num_threads; ++t) {
+			checkers.emplace_back([&, t] {
+				const int CHUNK{ 256 };
+				while (true) {
+					int begin = next_key.fetch_add(CHUNK);
+					if (begin >= range) return;
+
+					for (int v = begin; v < std::min(range, begin + CHUNK); ++v) {
+						auto r = check_key(&events[offset[v]], static_cast<int>(offset[v + 1] - offset[v]),
+							present[v] != 0, errors[t]);
+						if (r == LIN_RESULT::OK) continue;
+
+						if (results[t] != LIN_RESULT::VIOLATION) results[t] = r;
+						if (r == LIN_RESULT::VIOLATION) {
+							next_key = range;
+							return;
+						}
+					}
+				}
+			});
+		}
+
+		for (auto& th : checkers) th.join();
+
+		LIN_RESULT result{ LIN_RESULT::OK };
+		for (int t = 0; t < num_threads; ++t) {
+			if (results[t] == LIN_RESULT::OK) continue;
+			if (result == LIN_RESULT::VIOLATION) continue;
+			result = results[t];
+			error = errors[t];
+		}
+
+		return result;
+	}
+
+private:
+	static int apply(const EVENT& e, int state) // next state, or -1 if e cannot happen in state
+	{
+		switch (e.op) {
+		case OP_ADD:
+			if (e.result != (state == 0)) return -1;
+			return 1;
+		case OP_REMOVE:
+			if (e.result != (state == 1)) return -1;
+			return 0;
+		default:
+			if (e.result != (state == 1)) return -1;
+			return state;
+		}
+	}
+
+	LIN_RESULT check_key(EVENT* ev, int n, bool initial, std::string& error)
+	{
+		std::sort(ev, ev + n, [](const EVENT& a, const EVENT& b) { return a.invoke < b.invoke; });
+
+		int states{ initial ? 2 : 1 }; // bit 0 : absent, bit 1 : present
+		LIN_RESULT result{ LIN_RESULT::OK };
+
+		for (int begin = 0; begin < n;) {
+			int end = begin + 1;
+			auto last_response = ev[begin].response;
+			while (end < n and ev[end].invoke <= last_response) {
+				last_response = std::max(last_response, ev[end].response);
+				++end;
+			}
+
+			int next_states{ 0 };
+			bool limited{ false };
+			for (int s = 0; s < 2; ++s) {
+				if (states & (1 << s)) next_states |= search(ev + begin, end - begin, s, limited);
+			}
+
+			if (limited) {
+				// give up on this key, but keep going with both states possible
+				result = LIN_RESULT::UNKNOWN;
+				error = "UNKNOWN. The value " + std::to_string(ev[begin].value) + " has a segment of "
+					+ std::to_string(end - begin) + " overlapping operations, search limit exceeded.";
+				next_states = 3;
+			}
+			else if (next_states == 0) {
+				error = "ERROR. Operations on the value " + std::to_string(ev[begin].value)
+					+ " are not linearizable (segment of " + std::to_string(end - begin) + " operations"
+					+ ", value " + (states == 2 ? "present" : states == 1 ? "absent" : "unknown")
+					+ " before it).";
+				return LIN_RESULT::VIOLATION;
+			}
+
+			states = next_states;
+			begin = end;
+		}
+
+		return result;
+	}
+
+	// Configuration: every operation below p is linearized, plus the ones in
+	// extra (sorted, all above p), with the register in state.
+	struct Config {
+		int state;
+		int p;
+		std::vector<int> extra;
+
+		bool operator==(const Config& other) const
+		{
+			return state == other.state and p == other.p and extra == other.extra;
+		}
+	};
+
+	struct ConfigHash {
+		size_t operator()(const Config& c) const
+		{
+			size_t h = c.state * 0x9E3779B97F4A7C15ULL ^ c.p;
+			for (int i : c.extra) h = h * 0x100000001B3ULL ^ i;
+			return h;
+		}
+	};
+
+	// Returns the set of states reachable after linearizing all m events.
+	static int search(const EVENT* ev, int m, int initial, bool& limited)
+	{
+		if (m == 1) {
+			int s = apply(ev[0], initial);
+			return s < 0 ? 0 : 1 << s;
+		}
+
+		int reachable{ 0 };
+		std::unordered_set<Config, ConfigHash> seen;
+		std::vector<Config> stack{ Config{ initial, 0, {} } };
+		seen.insert(stack.back());
+
+		std::vector<int> candidates;
+		while (not stack.empty() and reachable != 3) {
+			Config c = std::move(stack.back());
+			stack.pop_back();
+
+			// an operation may go next if it was invoked before every pending
+			// operation responded
+			auto min_response = ~0ULL;
+			candidates.clear();
+			size_t x{ 0 };
+			for (int i = c.p; i < m; ++i) {
+				if (x < c.extra.size() and c.extra[x] == i) {
+					++x;
+					continue;
+				}
+				if (ev[i].invoke > min_response) break;
+				min_response = std::min(min_response, ev[i].response);
+				candidates.push_back(i);
+			}
+
+			for (int i : candidates) {
+				if (ev[i].invoke > min_response) break;
+
+				int s = apply(ev[i], c.state);
+				if (s < 0) continue;
+
+				Config next{ s, c.p, c.extra };
+				if (i == c.p) {
+					next.p++;
+					size_t k{ 0 };
+					while (k < next.extra.size() and next.extra[k] == next.p) {
+						next.p++;
+						++k;
+					}
+					next.extra.erase(next.extra.begin(), next.extra.begin() + k);
+				}
+				else {
+					next.extra.insert(std::lower_bound(next.extra.begin(), next.extra.end(), i), i);
+				}
+
+				if (next.p == m) {
+					reachable |= 1 << s;
+					continue;
+				}
+
+				if (seen.insert(next).second) {
+					if (seen.size() > SEARCH_LIMIT) {
+						limited = true;
+						return reachable;
+					}
+					stack.push_back(std::move(next));
+				}
+			}
+		}
+
+		return reachable;
+	}
+};
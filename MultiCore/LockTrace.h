@@ -0,0 +1,173 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iomanip>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+#include "Clock.h"
+
+// Lock timeline tracer. Build with LOCK_TRACE defined to enable it; otherwise
+// TRACE_LOCK() expands to nothing. Every thread writes wait / acquired /
+// released events into its own ring buffer (single writer, no atomics on the
+// hot path; the oldest events are overwritten), and write_chrome_trace() turns
+// them into wait and hold slices for chrome://tracing or ui.perfetto.dev.
+enum LOCK_EVENT { LOCK_WAIT, LOCK_ACQUIRED, LOCK_RELEASED };
+
+class LockTracer {
+public:
+	static constexpr int MAX_TRACE_THREADS{ 64 };
+	static constexpr size_t RING_SIZE{ 1 << 16 }; // events per thread, a power of two
+
+	void record(LOCK_EVENT event, const volatile void* lock)
+	{
+		if (not enabled.load(std::memory_order_relaxed)) return;
+
+		Ring* ring = my_ring();
+		if (ring == nullptr) return;
+
+		ring->events[ring->count & (RING_SIZE - 1)] = { ticks(), const_cast<const void*>(lock), event };
+		ring->count++;
+	}
+
+	// Drops everything recorded so far and starts recording. Call it while no
+	// traced thread is running.
+	void start()
+	{
+		for (auto& r : rings) {
+			Ring* ring = r.load();
+			if (ring) ring->count = 0;
+		}
+		enabled = true;
+	}
+
+	void stop() { enabled = false; }
+
+	// Pairs each thread's events per lock: wait -> acquired is a "wait" slice,
+	// acquired -> released a "hold" slice. Events whose partner fell out of
+	// the ring are dropped. Slices are async events keyed by (lock, thread) so
+	// the overlapping holds of hand-over-hand locking stay well nested.
+	bool write_chrome_trace(const std::string& path) const
+	{
+		std::ofstream out{ path };
+		if (not out) return false;
+
+		const double us_per_tick{ ns_per_tick() / 1'000.0 };
+		unsigned long long origin{ ~0ULL };
+		for (auto& r : rings) {
+			Ring* ring = r.load();
+			if (ring == nullptr or ring->count == 0) continue;
+			origin = std::min(origin, ring->events[first(*ring) & (RING_SIZE - 1)].ticks);
+		}
+
+		out << std::fixed << std::setprecision(3); // microseconds with ns resolution
+		out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+		bool comma{ false };
+		auto slice = [&](const char* name, int tid, const void* lock, unsigned long long from, unsigned long long to) {
+			for (int phase = 0; phase < 2; ++phase) {
+				out << (comma ? ",\n" : "\n") << "{\"cat\":\"lock\",\"name\":\"" << name
+					<< "\",\"ph\":\"" << (phase == 0 ? 'b' : 'e') << "\",\"pid\":0,\"tid\":" << tid
+					<< ",\"id\":\"" << lock << "/" << tid << "\",\"ts\":"
+					<< ((phase == 0 ? from : to) - origin) * us_per_tick << "}";
+				comma = true;
+			}
+		};
+
+		for (int t = 0; t < MAX_TRACE_THREADS; ++t) {
+			Ring* ring = rings[t].load();
+			if (ring == nullptr or ring->count == 0) continue;
+
+			out << (comma ? ",\n" : "\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << t
+				<< ",\"args\":{\"name\":\"thread " << t << "\"}}";
+			comma = true;
+
+			// state of every lock this thread touched: last wait and acquire stamps
+			struct Open { const void* lock; unsigned long long wait; unsigned long long acquired; };
+			std::vector<Open> open;
+			auto find = [&](const void* lock) -> Open& {
+				for (auto& o : open) {
+					if (o.lock == lock) return o;
+				}
+				open.push_back({ lock, 0, 0 });
+				return open.back();
+			};
+
+			for (auto i = first(*ring); i < ring->count; ++i) {
+				const Event& e = ring->events[i & (RING_SIZE - 1)];
+				Open& o = find(e.lock);
+				switch (e.type) {
+				case LOCK_WAIT:
+					o.wait = e.ticks;
+					o.acquired = 0;
+					break;
+				case LOCK_ACQUIRED:
+					if (o.wait != 0) slice("wait", t, e.lock, o.wait, e.ticks);
+					o.wait = 0;
+					o.acquired = e.ticks;
+					break;
+				case LOCK_RELEASED:
+					if (o.acquired != 0) slice("hold", t, e.lock, o.acquired, e.ticks);
+					o.acquired = 0;
+					// a thread holds only a few locks at a time, forget the released ones
+					if (open.size() > 16) {
+						open.erase(std::remove_if(open.begin(), open.end(), [](const Open& x) {
+							return x.wait == 0 and x.acquired == 0;
+							}), open.end());
+					}
+					break;
+				}
+			}
+		}
+		out << "\n]}\n";
+
+		return static_cast<bool>(out);
+	}
+
+private:
+	struct Event {
+		unsigned long long ticks;
+		const void* lock;
+		LOCK_EVENT type;
+	};
+
+	struct alignas(64) Ring {
+		unsigned long long count{ 0 };
+		std::unique_ptr<Event[]> events{ new Event[RING_SIZE] };
+	};
+
+	static unsigned long long first(const Ring& ring)
+	{
+		return ring.count > RING_SIZE ? ring.count - RING_SIZE : 0;
+	}
+
+	// Each thread claims a ring the first time it records; rings live until
+	// the program exits so a dump can run after the threads are gone. Threads
+	// beyond the first MAX_TRACE_THREADS are not traced.
+	Ring* my_ring()
+	{
+		thread_local Ring* ring{ nullptr };
+		if (ring) return ring;
+
+		int slot = next_slot.fetch_add(1);
+		if (slot >= MAX_TRACE_THREADS) return nullptr;
+
+		ring = new Ring;
+		rings[slot] = ring;
+		return ring;
+	}
+
+	std::atomic<bool> enabled{ false };
+	std::atomic<int> next_slot{ 0 };
+	std::atomic<Ring*> rings[MAX_TRACE_THREADS]{};
+};
+
+inline LockTracer lock_tracer;
+
+#if defined(LOCK_TRACE)
+#define TRACE_LOCK(event, lock) lock_tracer.record(event, lock)
+#else
+#define TRACE_LOCK(event, lock) ((void)0)
+#endif
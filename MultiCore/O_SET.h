@@ -0,0 +1,210 @@
+#pragma once
+
+#include <iostream>
+#include <mutex>
+#include <limits>
+
+#include "Common.h"
+#include "OpStats.h"
+
+class O_NODE {
+public:
+	int value;
+	O_NODE* next;
+	std::mutex mtx;
+
+	O_NODE(int v) : next(nullptr), value(v) {}
+
+	void lock() { mtx.lock(); }
+	void unlock() { mtx.unlock(); }
+};
+
+class O_SET {
+public:
+	O_SET()
+	{
+		head = new O_NODE(std::numeric_limits<int>::min());
+		tail = new O_NODE(std::numeric_limits<int>::max());
+		head->next = tail;
+	}
+
+	~O_SET()
+	{
+		clear();
+		delete head;
+		delete tail;
+	}
+
+	void clear()
+	{
+		O_NODE* curr = head->next;
+		while (curr != tail) {
+			O_NODE* temp = curr;
+			curr = curr->next;
+			delete temp;
+		}
+
+		head->next = tail;
+	}
+
+	bool add(int v)
+	{
+		while(true) {
+			auto prev = head;
+			auto curr = prev->next;
+
+			while (curr->value < v) {
+				STAT_INC(STAT_TRAVERSED);
+				prev = curr;
+				curr = curr->next;
+			}
+
+			prev->lock();
+			curr->lock();
+			if (false == validate(v, prev, curr)) {
+				STAT_INC(STAT_VALIDATE_FAIL);
+				prev->unlock();
+				curr->unlock();
+				continue;
+			}
+
+			if (curr->value == v) {
+				prev->unlock();
+				curr->unlock();
+
+				return false;
+			}
+
+			else {
+				auto newNode = new O_NODE(v);
+				newNode->next = curr;
+				prev->next = newNode;
+
+				prev->unlock();
+				curr->unlock();
+
+				return true;
+			}
+		}
+	}
+
+	bool remove(int v)
+	{
+		while (true) {
+			auto prev = head;
+			auto curr = prev->next;
+
+			while (curr->value < v) {
+				STAT_INC(STAT_TRAVERSED);
+				prev = curr;
+				curr = curr->next;
+			}
+
+			prev->lock();
+			curr->lock();
+			if (false == validate(v, prev, curr)) {
+				STAT_INC(STAT_VALIDATE_FAIL);
+				prev->unlock();
+				curr->unlock();
+				continue;
+			}
+
+			if (curr->value == v) {
+				prev->next = curr->next;
+
+				prev->unlock();
+				curr->unlock();
+
+				return true;
+			}
+
+			else {
+				prev->unlock();
+				curr->unlock();
+
+				return false;
+			}
+		}
+	}
+
+	bool contains(int v)
+	{
+		while (true) {
+			auto prev = head;
+			auto curr = prev->next;
+
+			while (curr->value < v) {
+				STAT_INC(STAT_TRAVERSED);
+				prev = curr;
+				curr = curr->next;
+			}
+
+			prev->lock();
+			curr->lock();
+			if (false == validate(v, prev, curr)) {
+				STAT_INC(STAT_VALIDATE_FAIL);
+				prev->unlock();
+				curr->unlock();
+				continue;
+			}
+
+			if (curr->value == v) {
+				prev->unlock();
+				curr->unlock();
+
+				return true;
+			}
+
+			else {
+				prev->unlock();
+				curr->unlock();
+
+				return false;
+			}
+		}
+	}
+
+	void print20()
+	{
+		auto curr = head->next;
+
+		for (int i = 0; i < 20 and curr != tail; ++i) {
+			std::cout << curr->value << ", ";
+			curr = curr->next;
+		}
+		std::cout << std::endl;
+	}
+
+private:
+	bool validate(int v, O_NODE* p, O_NODE* c)
+	{
+		auto prev = head;
+		auto curr = prev->next;
+
+		while (curr->value < v) {
+			STAT_INC(STAT_TRAVERSED);
+			prev = curr;
+			curr = curr->next;
+		}
+			
+		return ((prev == p) && (curr == c));
+
+		/*{
+			O_NODE* node = head;
+
+			while (node->value <= p->value) {
+				if(node == p){
+					return p->next = c;
+				}
+
+				node = node->next;
+			}
+
+			return false;
+		}*/
+	}
+
+private:
+	O_NODE* head;
+	O_NODE* tail;
+};
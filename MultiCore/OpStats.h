@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Common.h"
+
+// Contention counters for the set hot paths. Build with SET_STATS defined to
+// enable them; otherwise STAT_INC() expands to nothing and costs nothing.
+enum STAT_COUNTER { STAT_TRAVERSED, STAT_VALIDATE_FAIL, STAT_RESTART, STAT_CAS_FAIL,
+	STAT_MARK_FAIL, STAT_COUNTERS };
+
+inline const char* STAT_NAMES[STAT_COUNTERS]{ "traversed", "validate-fail", "restart",
+	"CAS-fail", "mark-fail" };
+
+struct alignas(64) StatBlock { // one cache line per thread
+	long long counter[STAT_COUNTERS];
+};
+
+inline StatBlock stat_blocks[MAX_THREADS];
+
+#if defined(SET_STATS)
+#define STAT_ADD(c, n) (stat_blocks[threadId].counter[c] += (n))
+#else
+#define STAT_ADD(c, n) ((void)0)
+#endif
+
+#define STAT_INC(c) STAT_ADD(c, 1)
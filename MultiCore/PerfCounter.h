@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+
+#if defined(__linux__)
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+enum PERF_EVENT { PERF_CYCLES, PERF_INSTRUCTIONS, PERF_L1D_MISSES, PERF_LLC_MISSES,
+	PERF_BRANCH_MISSES, PERF_XFER, PERF_EVENTS };
+
+inline const char* PERF_EVENT_NAMES[PERF_EVENTS]{ "cycles", "instr", "L1D-miss", "LLC-miss",
+	"br-miss", "xfer" };
+
+struct PerfSample {
+	std::array<unsigned long long, PERF_EVENTS> value{};
+	std::array<bool, PERF_EVENTS> valid{};
+
+	void merge(const PerfSample& other)
+	{
+		for (int i = 0; i < PERF_EVENTS; ++i) {
+			if (not other.valid[i]) continue;
+			value[i] += other.value[i];
+			valid[i] = true;
+		}
+	}
+};
+
+// Hardware counters of the calling thread, read through perf_event_open.
+// Cache-line transfers have no generic event, so PERF_XFER is only counted
+// when a raw PMU event code is given (e.g. 0x04d2, MEM_LOAD_L3_HIT_RETIRED.XSNP_HITM
+// on Skylake). Events the kernel refuses are reported as unavailable.
+class PerfCounter {
+public:
+	PerfCounter(unsigned long long raw_xfer = 0)
+	{
+#if defined(__linux__)
+		fd.fill(-1);
+
+		open_event(PERF_CYCLES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+		open_event(PERF_INSTRUCTIONS, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+		open_event(PERF_L1D_MISSES, PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+			| (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+		open_event(PERF_LLC_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+		open_event(PERF_BRANCH_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+		if (raw_xfer != 0) open_event(PERF_XFER, PERF_TYPE_RAW, raw_xfer);
+#else
+		(void)raw_xfer;
+#endif
+	}
+
+	~PerfCounter()
+	{
+#if defined(__linux__)
+		for (int f : fd) {
+			if (f >= 0) close(f);
+		}
+#endif
+	}
+
+	PerfCounter(const PerfCounter&) = delete;
+	PerfCounter& operator=(const PerfCounter&) = delete;
+
+	void start()
+	{
+#if defined(__linux__)
+		for (int f : fd) {
+			if (f < 0) continue;
+			ioctl(f, PERF_EVENT_IOC_RESET, 0);
+			ioctl(f, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+
+	PerfSample stop()
+	{
+		PerfSample sample;
+#if defined(__linux__)
+		for (int i = 0; i < PERF_EVENTS; ++i) {
+			if (fd[i] < 0) continue;
+			ioctl(fd[i], PERF_EVENT_IOC_DISABLE, 0);
+
+			// value, time enabled, time running; scale up if the PMU was multiplexed
+			unsigned long long data[3]{};
+			if (read(fd[i], data, sizeof(data)) != sizeof(data) or data[2] == 0) continue;
+
+			sample.value[i] = static_cast<unsigned long long>(
+				static_cast<double>(data[0]) * data[1] / data[2]);
+			sample.valid[i] = true;
+		}
+#endif
+		return sample;
+	}
+
+private:
+#if defined(__linux__)
+	void open_event(int index, unsigned int type, unsigned long long config)
+	{
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		fd[index] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+	}
+
+	std::array<int, PERF_EVENTS> fd;
+#endif
+};
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#include "Common.h"
+#include "OpStats.h"
+#include "LF_SET.h"
+#include "SimdSearch.h"
+
+// Read-copy-update set for read-mostly workloads. The whole set is one
+// immutable sorted array behind an atomic pointer. contains() loads the
+// pointer and searches the array without writing anything but its own EBR
+// slot. add / remove post a request; whoever holds the writer lock applies
+// every pending request in one merge into a new array, publishes it and
+// retires the old one through EBR.
+
+class RCU_ARRAY {
+public:
+	static constexpr int PADDING{ 16 }; // count_less16() may read past the last key
+
+	int size;
+	int epoch; // For EBR
+	int* keys;
+
+	RCU_ARRAY(int capacity) : size(0), epoch(0), keys(new int[capacity + PADDING]) {}
+	~RCU_ARRAY() { delete[] keys; }
+
+	void pad() { std::fill(keys + size, keys + size + PADDING, std::numeric_limits<int>::max()); }
+
+	// Branchless binary search down to a block of 16, then one SIMD compare.
+	bool contains(int v) const
+	{
+		const int* base = keys;
+		int len = size;
+
+		while (len > 16) {
+			const int half = len / 2;
+			base = (base[half] < v) ? base + half : base;
+			len -= half;
+		}
+
+		const int pos = static_cast<int>(base - keys) + count_less16(base, v);
+		return pos < size and keys[pos] == v;
+	}
+};
+
+class RCU_SET {
+	struct alignas(64) REQUEST {
+		std::atomic<bool> pending{ false };
+		bool add;
+		int value;
+		bool result;
+	};
+
+public:
+	RCU_SET()
+	{
+		auto empty = new RCU_ARRAY(0);
+		empty->pad();
+		current = empty;
+	}
+
+	~RCU_SET()
+	{
+		delete current.load();
+	}
+
+	void clear()
+	{
+		auto empty = new RCU_ARRAY(0);
+		empty->pad();
+		delete current.exchange(empty);
+		ebr.recycle();
+	}
+
+	bool add(int v)
+	{
+		return update(true, v);
+	}
+
+	bool remove(int v)
+	{
+		return update(false, v);
+	}
+
+	bool contains(int v)
+	{
+		ebr.StartRead();
+		bool result = current.load()->contains(v);
+		ebr.EndOp();
+		return result;
+	}
+
+	void print20()
+	{
+		auto array = current.load();
+
+		for (int i = 0; i < 20 and i < array->size; ++i) {
+			std::cout << array->keys[i] << ", ";
+		}
+		std::cout << std::endl;
+	}
+
+private:
+	bool update(bool add, int v)
+	{
+		// an add of a present key or a remove of a missing one changes
+		// nothing and needs no copy
+		ebr.StartRead();
+		bool present = current.load()->contains(v);
+		ebr.EndOp();
+		if (present == add) return false;
+
+		auto& request = requests[threadId];
+		request.add = add;
+		request.value = v;
+		request.pending.store(true, std::memory_order_release);
+
+		while (request.pending.load(std::memory_order_acquire)) {
+			if (writer.try_lock()) {
+				if (request.pending.load(std::memory_order_acquire)) combine();
+				writer.unlock();
+			}
+			else std::this_thread::yield();
+		}
+		return request.result;
+	}
+
+	// Applies every pending request in one pass over the current array.
+	// Requests on the same key take effect in thread order.
+	void combine()
+	{
+		ebr.StartOp();
+
+		batch.clear();
+		for (int i = 0; i < MAX_THREADS; ++i) {
+			if (requests[i].pending.load(std::memory_order_acquire)) batch.push_back(&requests[i]);
+		}
+		std::stable_sort(batch.begin(), batch.end(), [](REQUEST* a, REQUEST* b) { return a->value < b->value; });
+
+		auto old = current.load();
+		auto array = ebr.newNode(old->size + static_cast<int>(batch.size()));
+
+		int i{ 0 };
+		int n{ 0 };
+		for (size_t j = 0; j < batch.size();) {
+			const int v = batch[j]->value;
+			while (i < old->size and old->keys[i] < v) array->keys[n++] = old->keys[i++];
+
+			bool present = i < old->size and old->keys[i] == v;
+			if (present) ++i;
+			for (; j < batch.size() and batch[j]->value == v; ++j) {
+				batch[j]->result = (present != batch[j]->add);
+				present = batch[j]->add;
+			}
+			if (present) array->keys[n++] = v;
+		}
+		while (i < old->size) array->keys[n++] = old->keys[i++];
+
+		array->size = n;
+		array->pad();
+		current.store(array);
+		ebr.deleteNode(old);
+
+		for (auto request : batch) request->pending.store(false, std::memory_order_release);
+
+		ebr.EndOp();
+	}
+
+private:
+	std::atomic<RCU_ARRAY*> current;
+	REQUEST requests[MAX_THREADS];
+
+	std::mutex writer;
+	std::vector<REQUEST*> batch; // only touched under writer
+
+	BasicEBR<RCU_ARRAY> ebr;
+};
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#include "Common.h"
+
+// Range-partitioned front-end over SHARDS independent sets of any class here.
+// Shard i owns the keys in [bounds[i - 1], bounds[i]); every shard has its own
+// head on its own cache lines, and each list is about 1/SHARDS as long.
+//
+// Every thread counts, in its own lines, the operations and the change in
+// size it caused per shard. Every PERIOD operations a thread checks whether
+// one shard carries more than IMBALANCE times its share of keys + recent
+// operations, once the recent operations are at least half the size of the
+// set. If so it picks target boundaries that give each shard an equal share,
+// taking each shard's share to be spread evenly over its key range.
+//
+// Rebalancing runs alone, behind a lock whose read side only writes the
+// reader's own flag. Only keys that exist move: SET::keys_in() lists the keys
+// between a boundary and its target, and each one is removed from its shard
+// and added to the neighbour. A stop moves at most MAX_MOVES keys, with one
+// keys_in() walk per boundary; a boundary that runs out of budget stays part
+// way, and the next check of any thread carries on. So a stop costs at most
+// 2 * MAX_MOVES shard operations + SHARDS - 1 walks whatever the width of the
+// key range, and at most one stop happens per PERIOD operations.
+template <class SET, int SHARDS = 8>
+class SHARD_SET {
+	struct alignas(64) SHARD {
+		SET set;
+	};
+
+	struct alignas(64) THREAD_STATE {
+		std::atomic<bool> active{ false };
+		int sinceCheck{ 0 };
+		std::atomic<long long> ops[SHARDS]{};  // operations on each shard
+		std::atomic<long long> size[SHARDS]{}; // keys added - keys removed
+	};
+
+public:
+	static constexpr int PERIOD{ 4096 };
+	static constexpr double IMBALANCE{ 1.5 };
+	static constexpr int MAX_MOVES{ 1024 }; // keys moved per stop
+
+	SHARD_SET()
+	{
+		std::fill(bounds, bounds + SHARDS - 1, 0); // nonnegative keys start in the last shard
+		std::fill(target, target + SHARDS - 1, 0);
+	}
+
+	// Only while no operation is in flight.
+	void clear()
+	{
+		for (auto& shard : shards) shard.set.clear();
+		for (auto& t : threads) {
+			for (auto& c : t.ops) c = 0;
+			for (auto& c : t.size) c = 0;
+			t.sinceCheck = 0;
+		}
+		for (int i = 0; i < SHARDS; ++i) {
+			baseline[i] = 0;
+			sizeOffset[i] = 0;
+		}
+		std::fill(bounds, bounds + SHARDS - 1, 0);
+		std::fill(target, target + SHARDS - 1, 0);
+		moving = false;
+		lo = std::numeric_limits<int>::max();
+		hi = std::numeric_limits<int>::min();
+	}
+
+	bool add(int v)
+	{
+		enter();
+
+		int expected = lo;
+		while (v < expected and not lo.compare_exchange_weak(expected, v));
+		expected = hi;
+		while (v > expected and not hi.compare_exchange_weak(expected, v));
+
+		const int i = owner(v, bounds);
+		bool result = shards[i].set.add(v);
+		count(i, result ? 1 : 0);
+
+		exit();
+		return result;
+	}
+
+	bool remove(int v)
+	{
+		enter();
+		const int i = owner(v, bounds);
+		bool result = shards[i].set.remove(v);
+		count(i, result ? -1 : 0);
+		exit();
+		return result;
+	}
+
+	bool contains(int v)
+	{
+		enter();
+		const int i = owner(v, bounds);
+		bool result = shards[i].set.contains(v);
+		count(i, 0);
+		exit();
+		return result;
+	}
+
+	// The first keys of every shard, one line per shard.
+	void print20()
+	{
+		for (auto& shard : shards) shard.set.print20();
+	}
+
+private:
+	static int owner(int v, const int* b)
+	{
+		return static_cast<int>(std::upper_bound(b, b + SHARDS - 1, v) - b);
+	}
+
+	void enter()
+	{
+		auto& me = threads[threadId];
+		while (true) {
+			me.active = true;
+			if (not rebalancing) return;
+
+			me.active = false;
+			while (rebalancing) std::this_thread::yield();
+		}
+	}
+
+	void exit()
+	{
+		auto& me = threads[threadId];
+		me.active.store(false, std::memory_order_release);
+
+		if (++me.sinceCheck < PERIOD) return;
+		me.sinceCheck = 0;
+		if (moving or imbalanced()) rebalance();
+	}
+
+	void count(int shard, int sizeChange)
+	{
+		auto& me = threads[threadId];
+		me.ops[shard].store(me.ops[shard].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		if (sizeChange != 0) {
+			me.size[shard].store(me.size[shard].load(std::memory_order_relaxed) + sizeChange, std::memory_order_relaxed);
+		}
+	}
+
+	// keys + operations since the last rebalance, per shard
+	void weights(long long window[], long long size[])
+	{
+		for (int i = 0; i < SHARDS; ++i) {
+			window[i] = -baseline[i].load(std::memory_order_relaxed);
+			size[i] = sizeOffset[i].load(std::memory_order_relaxed);
+		}
+		for (auto& t : threads) {
+			for (int i = 0; i < SHARDS; ++i) {
+				window[i] += t.ops[i].load(std::memory_order_relaxed);
+				size[i] += t.size[i].load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	bool imbalanced()
+	{
+		long long window[SHARDS], size[SHARDS];
+		weights(window, size);
+
+		long long totalWindow{ 0 }, totalSize{ 0 }, total{ 0 }, heaviest{ 0 };
+		for (int i = 0; i < SHARDS; ++i) {
+			totalWindow += window[i];
+			totalSize += size[i];
+			total += window[i] + size[i];
+			heaviest = std::max(heaviest, window[i] + size[i]);
+		}
+
+		if (totalWindow < PERIOD or totalWindow * 2 < totalSize) return false;
+		return heaviest > IMBALANCE * total / SHARDS;
+	}
+
+	void rebalance()
+	{
+		if (rebalancing.exchange(true)) return; // someone else is at it
+		for (auto& t : threads) {
+			while (t.active) std::this_thread::yield();
+		}
+
+		long long window[SHARDS], size[SHARDS];
+		weights(window, size);
+
+		// new targets, unless the last ones are still being reached
+		if (not moving) {
+			if (lo <= hi) split(window, size, target);
+			else std::copy(bounds, bounds + SHARDS - 1, target);
+		}
+		const bool done = move(size);
+
+		// fold the moves into the sizes; restart the window once there
+		long long ops[SHARDS]{}, counted[SHARDS]{};
+		for (auto& t : threads) {
+			for (int i = 0; i < SHARDS; ++i) {
+				ops[i] += t.ops[i].load(std::memory_order_relaxed);
+				counted[i] += t.size[i].load(std::memory_order_relaxed);
+			}
+		}
+		for (int i = 0; i < SHARDS; ++i) {
+			if (done) baseline[i] = ops[i];
+			sizeOffset[i] = size[i] - counted[i];
+		}
+
+		moving = not done;
+		rebalancing = false;
+	}
+
+	// Moves the bounds toward target, at most MAX_MOVES keys in all. Bounds
+	// going up are done from the top one down and bounds going down from the
+	// bottom one up, so the keys between a bound and its target are all in
+	// the one shard next to it. Returns whether every bound got there.
+	bool move(long long size[])
+	{
+		int budget{ MAX_MOVES };
+		for (int k = SHARDS - 2; k >= 0 and budget > 0; --k) {
+			if (target[k] > bounds[k]) budget -= move_up(k, size, budget);
+		}
+		for (int k = 0; k < SHARDS - 1 and budget > 0; ++k) {
+			if (target[k] < bounds[k]) budget -= move_down(k, size, budget);
+		}
+		return std::equal(bounds, bounds + SHARDS - 1, target);
+	}
+
+	// [bounds[k], target[k]) goes from shard k + 1 to shard k, lowest keys
+	// first; out of budget, the bound stops just above the last key moved.
+	int move_up(int k, long long size[], int budget)
+	{
+		keys.clear();
+		shards[k + 1].set.keys_in(bounds[k], target[k], keys);
+
+		const int n = std::min(budget, static_cast<int>(keys.size()));
+		for (int j = 0; j < n; ++j) transfer(keys[j], k + 1, k, size);
+		bounds[k] = (n < static_cast<int>(keys.size())) ? keys[n - 1] + 1 : target[k];
+		return n;
+	}
+
+	// [target[k], bounds[k]) goes from shard k to shard k + 1, highest keys
+	// first; out of budget, the bound stops at the last key moved.
+	int move_down(int k, long long size[], int budget)
+	{
+		keys.clear();
+		shards[k].set.keys_in(target[k], bounds[k], keys);
+
+		const int first = std::max(0, static_cast<int>(keys.size()) - budget);
+		for (int j = first; j < static_cast<int>(keys.size()); ++j) transfer(keys[j], k, k + 1, size);
+		bounds[k] = (first > 0) ? keys[first] : target[k];
+		return static_cast<int>(keys.size()) - first;
+	}
+
+	void transfer(int v, int from, int to, long long size[])
+	{
+		if (shards[from].set.remove(v)) {
+			shards[to].set.add(v);
+			size[from]--;
+			size[to]++;
+		}
+	}
+
+	// New bounds that give every shard an equal share of the weight, with each
+	// old shard's weight spread evenly over its part of [lo, hi].
+	void split(const long long window[], const long long size[], int next[])
+	{
+		long long total{ 0 };
+		for (int i = 0; i < SHARDS; ++i) total += window[i] + size[i];
+		if (total <= 0) {
+			std::copy(bounds, bounds + SHARDS - 1, next);
+			return;
+		}
+
+		const long long first = lo, last = static_cast<long long>(hi) + 1;
+		auto clamp = [&](long long x) { return std::clamp(x, first, last); };
+
+		int k{ 0 };
+		long long before{ 0 };
+		for (int i = 0; i < SHARDS and k < SHARDS - 1; ++i) {
+			const long long from = clamp(i == 0 ? first : bounds[i - 1]);
+			const long long to = clamp(i == SHARDS - 1 ? last : bounds[i]);
+			const long long w = window[i] + size[i];
+
+			while (k < SHARDS - 1 and (k + 1) * total <= (before + w) * SHARDS) {
+				const double share = (static_cast<double>(k + 1) * total / SHARDS - before) / std::max(w, 1LL);
+				next[k] = static_cast<int>(from + static_cast<long long>(share * (to - from)));
+				if (k > 0) next[k] = std::max(next[k], next[k - 1]);
+				++k;
+			}
+			before += w;
+		}
+		for (; k < SHARDS - 1; ++k) next[k] = static_cast<int>(last);
+	}
+
+private:
+	SHARD shards[SHARDS];
+	int bounds[SHARDS - 1]; // written only while rebalancing
+	int target[SHARDS - 1]; // where the bounds are being moved to
+	std::vector<int> keys;  // keys_in() results, only while rebalancing
+
+	alignas(64) std::atomic<bool> rebalancing{ false };
+	std::atomic<bool> moving{ false }; // the bounds have not reached target yet
+	std::atomic<long long> baseline[SHARDS]{};   // ops per shard at the last rebalance
+	std::atomic<long long> sizeOffset[SHARDS]{}; // keys moved in - moved out, per shard
+	std::atomic<int> lo{ std::numeric_limits<int>::max() };
+	std::atomic<int> hi{ std::numeric_limits<int>::min() };
+
+	THREAD_STATE threads[MAX_THREADS];
+};
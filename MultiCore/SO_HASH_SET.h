@@ -0,0 +1,305 @@
+#pragma once
+
+#include <iostream>
+#include <atomic>
+#include <limits>
+#include <bit>
+
+#include "Common.h"
+#include "OpStats.h"
+#include "LF_SET.h"
+
+// Split-ordered lock-free hash set (Shalev & Shavit, "Split-Ordered Lists").
+// Every key lives in one LF_SET style list sorted by its bit-reversed key, so
+// splitting a bucket never moves a node: the new bucket just gets a sentinel
+// node in the middle of its parent's chain. Buckets are created on first use
+// and the directory grows by whole segments, so there is no rehash pause.
+
+class SO_NODE;
+using SO_AMR = BasicAMR<SO_NODE>;
+
+class SO_NODE {
+public:
+	unsigned long long key; // split-order key, odd for values, even for sentinels
+	int value;
+	SO_AMR next;
+	int epoch; // For EBR
+
+	SO_NODE(unsigned long long k, int v) : key(k), value(v), epoch(0) {}
+};
+
+class SO_HASH_SET {
+public:
+	static constexpr int SEGMENTS{ 31 };   // segment s > 0 holds buckets [2^(s-1), 2^s)
+	static constexpr int LOAD_FACTOR{ 2 }; // average chain length before doubling
+
+	SO_HASH_SET()
+	{
+		head = new SO_NODE(sentinel_key(0), 0);
+		tail = new SO_NODE(std::numeric_limits<unsigned long long>::max(), std::numeric_limits<int>::max());
+		head->next = tail;
+		bucket(0) = head;
+	}
+
+	~SO_HASH_SET()
+	{
+		clear();
+		delete head;
+		delete tail;
+		for (auto& s : segments) delete[] s.load();
+	}
+
+	void clear()
+	{
+		SO_NODE* curr = head->next.GetPtr();
+
+		while (curr != tail) {
+			SO_NODE* temp = curr;
+			curr = curr->next.GetPtr();
+			delete temp;
+		}
+
+		head->next = tail;
+		for (int s = 1; s < SEGMENTS; ++s) {
+			auto segment = segments[s].load();
+			if (segment == nullptr) continue;
+			for (int i = 0; i < segment_size(s); ++i) segment[i] = nullptr;
+		}
+		bucketSize = 2;
+		count = 0;
+	}
+
+	bool add(int v)
+	{
+		ebr.StartOp();
+
+		SO_NODE* start = get_bucket(bucket_of(v));
+		const auto key = regular_key(v);
+
+		while (true) {
+			SO_NODE* prev{ nullptr };
+			SO_NODE* curr{ nullptr };
+			find(start, key, prev, curr);
+
+			if (curr->key == key) {
+				ebr.EndOp();
+				return false;
+			}
+
+			else {
+				auto newNode = ebr.newNode(key, v);
+				newNode->next = curr;
+				if (prev->next.CAS(curr, newNode, false, false)) {
+					break;
+				}
+				STAT_INC(STAT_CAS_FAIL);
+				ebr.deleteNode(newNode);
+			}
+		}
+
+		// grow the directory; the new buckets fill in lazily
+		int size = bucketSize;
+		if (count.fetch_add(1) + 1 > size * LOAD_FACTOR and size < (1 << (SEGMENTS - 1))) {
+			bucketSize.compare_exchange_strong(size, size * 2);
+		}
+
+		ebr.EndOp();
+		return true;
+	}
+
+	bool remove(int v)
+	{
+		ebr.StartOp();
+
+		SO_NODE* start = get_bucket(bucket_of(v));
+		const auto key = regular_key(v);
+
+		while (true) {
+			SO_NODE* prev{ nullptr };
+			SO_NODE* curr{ nullptr };
+			find(start, key, prev, curr);
+
+			if (curr->key != key) {
+				ebr.EndOp();
+				return false;
+			}
+
+			else {
+				SO_NODE* succ = curr->next.GetPtr();
+				if (not curr->next.AttemptMark(succ, true)) {
+					STAT_INC(STAT_MARK_FAIL);
+					continue;
+				}
+
+				if (prev->next.CAS(curr, succ, false, false)) {
+					ebr.deleteNode(curr);
+				}
+				else {
+					STAT_INC(STAT_CAS_FAIL);
+				}
+
+				count--;
+				ebr.EndOp();
+				return true;
+			}
+		}
+	}
+
+	bool contains(int v)
+	{
+		ebr.StartOp();
+
+		SO_NODE* curr = get_bucket(bucket_of(v));
+		const auto key = regular_key(v);
+
+		while (curr->key < key) {
+			STAT_INC(STAT_TRAVERSED);
+			curr = curr->next.GetPtr();
+		}
+
+		bool result = curr->key == key and not curr->next.GetMark();
+
+		ebr.EndOp();
+		return result;
+	}
+
+	void print20()
+	{
+		auto curr = head->next.GetPtr();
+
+		for (int i = 0; i < 20 and curr != tail; ++i) {
+			if (curr->key & 1) std::cout << curr->value << ", ";
+			else --i;
+			curr = curr->next.GetPtr();
+		}
+		std::cout << std::endl;
+	}
+
+private:
+	static unsigned long long reverse_bits(unsigned int x)
+	{
+		x = ((x >> 1) & 0x5555'5555u) | ((x & 0x5555'5555u) << 1);
+		x = ((x >> 2) & 0x3333'3333u) | ((x & 0x3333'3333u) << 2);
+		x = ((x >> 4) & 0x0F0F'0F0Fu) | ((x & 0x0F0F'0F0Fu) << 4);
+		x = ((x >> 8) & 0x00FF'00FFu) | ((x & 0x00FF'00FFu) << 8);
+		return (x >> 16) | (x << 16);
+	}
+
+	// the low bit makes every value key odd and puts it after the sentinel
+	// of its own bucket
+	static unsigned long long regular_key(int v)
+	{
+		return reverse_bits(static_cast<unsigned int>(v)) << 1 | 1;
+	}
+
+	static unsigned long long sentinel_key(unsigned int b)
+	{
+		return reverse_bits(b) << 1;
+	}
+
+	unsigned int bucket_of(int v) const
+	{
+		return static_cast<unsigned int>(v) & (bucketSize.load() - 1);
+	}
+
+	static int segment_of(unsigned int b) { return std::bit_width(b); }
+	static int segment_size(int s) { return s == 0 ? 1 : 1 << (s - 1); }
+
+	std::atomic<SO_NODE*>& bucket(unsigned int b)
+	{
+		const int s = segment_of(b);
+		auto segment = segments[s].load();
+		if (segment == nullptr) {
+			auto fresh = new std::atomic<SO_NODE*>[segment_size(s)]{};
+			if (segments[s].compare_exchange_strong(segment, fresh)) segment = fresh;
+			else delete[] fresh;
+		}
+		return segment[s == 0 ? 0 : b - segment_size(s)];
+	}
+
+	SO_NODE* get_bucket(unsigned int b)
+	{
+		SO_NODE* sentinel = bucket(b);
+		if (sentinel == nullptr) sentinel = initialize_bucket(b);
+		return sentinel;
+	}
+
+	// The parent of bucket b is b without its highest set bit; its chain
+	// already contains every key of b, so b's sentinel goes in there.
+	SO_NODE* initialize_bucket(unsigned int b)
+	{
+		const unsigned int parent = b & ~std::bit_floor(b);
+		SO_NODE* start = get_bucket(parent);
+		const auto key = sentinel_key(b);
+
+		SO_NODE* sentinel{ nullptr };
+		while (sentinel == nullptr) {
+			SO_NODE* prev{ nullptr };
+			SO_NODE* curr{ nullptr };
+			find(start, key, prev, curr);
+
+			if (curr->key == key) {
+				sentinel = curr; // someone else got there first
+				break;
+			}
+
+			auto newNode = new SO_NODE(key, 0);
+			newNode->next = curr;
+			if (prev->next.CAS(curr, newNode, false, false)) sentinel = newNode;
+			else {
+				STAT_INC(STAT_CAS_FAIL);
+				delete newNode;
+			}
+		}
+
+		SO_NODE* expected{ nullptr };
+		bucket(b).compare_exchange_strong(expected, sentinel);
+		return sentinel;
+	}
+
+	// LF_SET_EBR::find, starting at a bucket sentinel instead of head.
+	// Sentinels are never marked, so start is always a valid prev.
+	void find(SO_NODE* start, unsigned long long key, SO_NODE*& prev, SO_NODE*& curr)
+	{
+		while (true) {
+		retry:
+			prev = start;
+			curr = prev->next.GetPtr();
+
+			while (true) {
+				bool currMark;
+				auto succ = curr->next.GetPtrAndMark(&currMark);
+
+				while (currMark) {
+					if (not prev->next.CAS(curr, succ, false, false)) {
+						STAT_INC(STAT_CAS_FAIL);
+						STAT_INC(STAT_RESTART);
+						goto retry;
+					}
+
+					ebr.deleteNode(curr);
+					curr = succ;
+					succ = curr->next.GetPtrAndMark(&currMark);
+				}
+
+				if (curr->key >= key) {
+					return;
+				}
+
+				STAT_INC(STAT_TRAVERSED);
+				prev = curr;
+				curr = succ;
+			}
+		}
+	}
+
+private:
+	SO_NODE* head; // sentinel of bucket 0
+	SO_NODE* tail;
+
+	std::atomic<std::atomic<SO_NODE*>*> segments[SEGMENTS]{};
+	std::atomic<int> bucketSize{ 2 };
+	std::atomic<int> count{ 0 };
+
+	BasicEBR<SO_NODE> ebr;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#endif
+
+// Number of keys < v among keys[0..16). All 16 slots must be readable; for a
+// sorted block this is where v is or would go. The compares run on the whole
+// block at once with AVX2 or SSE2 (always there on x64) and the movemask bits
+// are counted.
+inline int count_less16(const int* keys, int v)
+{
+#if defined(__AVX2__)
+	const __m256i key = _mm256_set1_epi32(v);
+	const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys));
+	const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + 8));
+	const unsigned int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(key, lo)))
+		| _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(key, hi))) << 8;
+	return std::popcount(mask);
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	const __m128i key = _mm_set1_epi32(v);
+	unsigned int mask{ 0 };
+	for (int i = 0; i < 16; i += 4) {
+		const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+		mask |= _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(key, block))) << i;
+	}
+	return std::popcount(mask);
+#else
+	int count{ 0 };
+	for (int i = 0; i < 16; ++i) count += keys[i] < v;
+	return count;
+#endif
+}
+
+// Number of set bits in words[0..n). With AVX2 each byte is counted by two
+// nibble lookups in one shuffle and the bytes are summed per 64-bit lane;
+// otherwise one popcount per word.
+inline long long popcount_words(const unsigned long long* words, size_t n)
+{
+	long long count{ 0 };
+	size_t i{ 0 };
+#if defined(__AVX2__)
+	const __m256i lookup = _mm256_setr_epi8(
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i low = _mm256_set1_epi8(0x0f);
+	__m256i sum = _mm256_setzero_si256();
+	for (; i + 4 <= n; i += 4) {
+		const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+		const __m256i lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(block, low));
+		const __m256i hi = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(block, 4), low));
+		sum = _mm256_add_epi64(sum, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+	}
+	alignas(32) long long lanes[4];
+	_mm256_store_si256(reinterpret_cast<__m256i*>(lanes), sum);
+	count = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+	for (; i < n; ++i) count += std::popcount(words[i]);
+	return count;
+}
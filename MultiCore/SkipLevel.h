@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Workload.h"
+
+const int SKIP_LEVELS{ 24 }; // enough for 2^24 keys at p = 1/2
+
+// Highest level of a new skiplist node: level k with probability 2^-(k+1).
+inline int random_skip_level()
+{
+	auto bits = thread_rand().next();
+	int top{ 0 };
+	while ((bits & 1) and top < SKIP_LEVELS - 1) {
+		++top;
+		bits >>= 1;
+	}
+	return top;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+
+struct Summary {
+	int n{ 0 };
+	double mean{ 0.0 };
+	double stddev{ 0.0 }; // sample standard deviation, 0 for a single sample
+	double ci95{ 0.0 };   // half width of the 95% confidence interval of the mean
+};
+
+// Two-sided 95% critical value of Student's t with df degrees of freedom.
+// Tabulated up to 30 (linear in between, df may be fractional for Welch),
+// Cornish-Fisher expansion above.
+inline double t_critical(double df)
+{
+	static const double TABLE[]{ 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+		2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+		2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+
+	if (df <= 1.0) return TABLE[0];
+	if (df < 30.0) {
+		int i = static_cast<int>(df);
+		double f = df - i;
+		return TABLE[i - 1] + (TABLE[i] - TABLE[i - 1]) * f;
+	}
+
+	const double z{ 1.959964 };
+	const double z3{ z * z * z };
+	const double z5{ z3 * z * z };
+	return z + (z3 + z) / (4.0 * df) + (5.0 * z5 + 16.0 * z3 + 3.0 * z) / (96.0 * df * df);
+}
+
+inline Summary summarize(const std::vector<double>& samples)
+{
+	Summary s;
+	s.n = static_cast<int>(samples.size());
+	if (s.n == 0) return s;
+
+	for (double x : samples) s.mean += x;
+	s.mean /= s.n;
+	if (s.n == 1) return s;
+
+	double sq{ 0.0 };
+	for (double x : samples) sq += (x - s.mean) * (x - s.mean);
+	s.stddev = std::sqrt(sq / (s.n - 1));
+	s.ci95 = t_critical(s.n - 1) * s.stddev / std::sqrt(static_cast<double>(s.n));
+	return s;
+}
+
+struct WelchResult {
+	double t{ 0.0 };
+	double df{ 0.0 };
+	bool significant{ false }; // the means differ at the 5% level (two-sided)
+};
+
+// Welch's unequal-variance t test of b against a. Needs two samples on each side.
+inline WelchResult welch(const Summary& a, const Summary& b)
+{
+	WelchResult w;
+	if (a.n < 2 or b.n < 2) return w;
+
+	const double va{ a.stddev * a.stddev / a.n };
+	const double vb{ b.stddev * b.stddev / b.n };
+	if (va + vb == 0.0) {
+		// identical samples on both sides: any difference is exact
+		w.significant = (a.mean != b.mean);
+		w.t = w.significant ? (b.mean > a.mean ? HUGE_VAL : -HUGE_VAL) : 0.0;
+		return w;
+	}
+
+	w.t = (b.mean - a.mean) / std::sqrt(va + vb);
+	w.df = (va + vb) * (va + vb) / (va * va / (a.n - 1) + vb * vb / (b.n - 1));
+	w.significant = std::abs(w.t) > t_critical(w.df);
+	return w;
+}
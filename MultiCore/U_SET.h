@@ -0,0 +1,306 @@
+#pragma once
+
+#include <iostream>
+#include <mutex>
+#include <atomic>
+#include <limits>
+#include <algorithm>
+
+#include "Common.h"
+#include "OpStats.h"
+#include "LF_SET.h"
+#include "SimdSearch.h"
+
+// Unrolled list: every node holds a sorted block of up to CAPACITY keys, so a
+// traversal touches two cache lines per CAPACITY keys instead of one per key.
+//
+// Nodes are never changed after they are linked. A writer locks prev and curr
+// like L_SET, builds the replacement node(s) - with the key added, removed,
+// split in two or merged with the next node - marks curr removed and swings
+// prev->next. contains() takes no locks and only retries when it lands on a
+// node that has been replaced. Replaced nodes go back through EBR.
+//
+// Key v belongs to the first node whose largest key is >= v; the last node
+// takes everything above.
+class U_NODE {
+public:
+	static constexpr int CAPACITY{ 16 }; // one count_less16() block
+
+	alignas(64) int keys[CAPACITY]; // sorted, the unused slots hold INT_MAX
+	int count;
+	int epoch; // For EBR
+	std::atomic<U_NODE*> next;
+	std::atomic<bool> removed;
+	std::mutex mtx;
+
+	U_NODE() : count(0), epoch(0), next(nullptr), removed(false)
+	{
+		std::fill(keys, keys + CAPACITY, std::numeric_limits<int>::max());
+	}
+
+	int max() const { return keys[count - 1]; }
+
+	// Where v is or would go; the unused slots keep the search inside the block.
+	int position(int v) const { return count_less16(keys, v); }
+
+	void lock() { mtx.lock(); }
+	void unlock() { mtx.unlock(); }
+};
+
+class U_SET {
+public:
+	static constexpr int CAPACITY{ U_NODE::CAPACITY };
+	static constexpr int MERGE_BELOW{ CAPACITY / 4 }; // a node this small tries to absorb its successor
+
+	U_SET()
+	{
+		head = new U_NODE;
+		head->keys[0] = std::numeric_limits<int>::min();
+		head->count = 1;
+		tail = new U_NODE;
+		head->next = tail;
+	}
+
+	~U_SET()
+	{
+		clear();
+		delete head;
+		delete tail;
+	}
+
+	void clear()
+	{
+		U_NODE* curr = head->next;
+
+		while (curr != tail) {
+			U_NODE* temp = curr;
+			curr = curr->next;
+			delete temp;
+		}
+
+		head->next = tail;
+	}
+
+	bool add(int v)
+	{
+		ebr.StartOp();
+
+		while (true) {
+			U_NODE* prev{ nullptr };
+			U_NODE* curr{ nullptr };
+			find(v, prev, curr);
+
+			prev->lock();
+			curr->lock();
+			if (false == validate(prev, curr, v)) {
+				STAT_INC(STAT_VALIDATE_FAIL);
+				prev->unlock();
+				curr->unlock();
+				continue;
+			}
+
+			if (curr == tail) { // empty set
+				auto newNode = make_node(&v, 1);
+				newNode->next = tail;
+				prev->next = newNode;
+
+				prev->unlock();
+				curr->unlock();
+				ebr.EndOp();
+				return true;
+			}
+
+			const int pos = curr->position(v);
+			if (pos < curr->count and curr->keys[pos] == v) {
+				prev->unlock();
+				curr->unlock();
+				ebr.EndOp();
+				return false;
+			}
+
+			int keys[CAPACITY + 1];
+			std::copy(curr->keys, curr->keys + pos, keys);
+			keys[pos] = v;
+			std::copy(curr->keys + pos, curr->keys + curr->count, keys + pos + 1);
+			const int count = curr->count + 1;
+
+			U_NODE* first;
+			if (count <= CAPACITY) {
+				first = make_node(keys, count);
+				first->next = curr->next.load();
+			}
+			else { // split
+				const int half = (count + 1) / 2;
+				first = make_node(keys, half);
+				auto second = make_node(keys + half, count - half);
+				second->next = curr->next.load();
+				first->next = second;
+			}
+			replace(prev, curr, first);
+
+			prev->unlock();
+			curr->unlock();
+			ebr.deleteNode(curr);
+			ebr.EndOp();
+			return true;
+		}
+	}
+
+	bool remove(int v)
+	{
+		ebr.StartOp();
+
+		while (true) {
+			U_NODE* prev{ nullptr };
+			U_NODE* curr{ nullptr };
+			find(v, prev, curr);
+
+			prev->lock();
+			curr->lock();
+			if (false == validate(prev, curr, v)) {
+				STAT_INC(STAT_VALIDATE_FAIL);
+				prev->unlock();
+				curr->unlock();
+				continue;
+			}
+
+			const int pos = (curr == tail) ? 0 : curr->position(v);
+			if (curr == tail or pos == curr->count or curr->keys[pos] != v) {
+				prev->unlock();
+				curr->unlock();
+				ebr.EndOp();
+				return false;
+			}
+
+			if (curr->count == 1) {
+				curr->removed = true;
+				prev->next = curr->next.load();
+
+				prev->unlock();
+				curr->unlock();
+				ebr.deleteNode(curr);
+				ebr.EndOp();
+				return true;
+			}
+
+			int keys[2 * CAPACITY];
+			std::copy(curr->keys, curr->keys + pos, keys);
+			std::copy(curr->keys + pos + 1, curr->keys + curr->count, keys + pos);
+			int count = curr->count - 1;
+
+			// curr is locked, so its successor cannot be replaced under us
+			U_NODE* succ = curr->next;
+			U_NODE* merged{ nullptr };
+			if (count < MERGE_BELOW and succ != tail) {
+				succ->lock();
+				if (count + succ->count <= CAPACITY) {
+					std::copy(succ->keys, succ->keys + succ->count, keys + count);
+					count += succ->count;
+					merged = succ;
+				}
+				else succ->unlock();
+			}
+
+			auto newNode = make_node(keys, count);
+			if (merged) {
+				newNode->next = merged->next.load();
+				merged->removed = true;
+			}
+			else newNode->next = succ;
+			replace(prev, curr, newNode);
+
+			if (merged) merged->unlock();
+			prev->unlock();
+			curr->unlock();
+			ebr.deleteNode(curr);
+			if (merged) ebr.deleteNode(merged);
+			ebr.EndOp();
+			return true;
+		}
+	}
+
+	bool contains(int v)
+	{
+		ebr.StartOp();
+
+		while (true) {
+			U_NODE* prev{ nullptr };
+			U_NODE* curr{ nullptr };
+			find(v, prev, curr);
+
+			if (curr == tail) {
+				ebr.EndOp();
+				return false;
+			}
+
+			const int pos = curr->position(v);
+			bool result = pos < curr->count and curr->keys[pos] == v;
+
+			// a replaced node may be missing a key its replacement has
+			if (curr->removed) {
+				STAT_INC(STAT_RESTART);
+				continue;
+			}
+
+			ebr.EndOp();
+			return result;
+		}
+	}
+
+	void print20()
+	{
+		auto curr = head->next.load();
+
+		int printed{ 0 };
+		while (printed < 20 and curr != tail) {
+			for (int i = 0; i < curr->count and printed < 20; ++i, ++printed) std::cout << curr->keys[i] << ", ";
+			curr = curr->next;
+		}
+		std::cout << std::endl;
+	}
+
+private:
+	// curr is the node v belongs to, or tail when the set is empty.
+	void find(int v, U_NODE*& prev, U_NODE*& curr)
+	{
+		prev = head;
+		curr = prev->next;
+
+		while (curr != tail) {
+			U_NODE* next = curr->next;
+			if (curr->max() >= v or next == tail) break;
+
+			STAT_INC(STAT_TRAVERSED);
+			prev = curr;
+			curr = next;
+		}
+	}
+
+	bool validate(U_NODE* p, U_NODE* c, int v)
+	{
+		return (p->removed == false)
+			and (c->removed == false)
+			and (p->next == c)
+			and (c == tail or c->max() >= v or c->next == tail);
+	}
+
+	U_NODE* make_node(const int* keys, int count)
+	{
+		auto node = ebr.newNode();
+		std::copy(keys, keys + count, node->keys);
+		node->count = count;
+		return node;
+	}
+
+	void replace(U_NODE* prev, U_NODE* curr, U_NODE* first)
+	{
+		curr->removed = true;
+		prev->next = first;
+	}
+
+private:
+	U_NODE* head;
+	U_NODE* tail;
+
+	BasicEBR<U_NODE> ebr;
+};
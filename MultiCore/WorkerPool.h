@@ -0,0 +1,281 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <fstream>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "Common.h"
+
+enum class PLACEMENT { NONE, COMPACT, SCATTER, SMT };
+
+inline bool parse_placement(const std::string& name, PLACEMENT& placement)
+{
+	if (name == "none") placement = PLACEMENT::NONE;
+	else if (name == "compact") placement = PLACEMENT::COMPACT;
+	else if (name == "scatter") placement = PLACEMENT::SCATTER;
+	else if (name == "smt") placement = PLACEMENT::SMT;
+	else return false;
+	return true;
+}
+
+struct CPU {
+	int id;
+	int package;
+	int core;
+	int sibling; // position among the hardware threads of the same core
+};
+
+inline std::vector<CPU> cpu_topology()
+{
+	std::vector<CPU> cpus;
+	const int n = static_cast<int>(std::thread::hardware_concurrency());
+
+	for (int i = 0; i < n; ++i) {
+		CPU cpu{ i, 0, i, 0 };
+#if defined(__linux__)
+		std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(i) + "/topology/";
+		std::ifstream package{ dir + "physical_package_id" };
+		std::ifstream core{ dir + "core_id" };
+		std::ifstream siblings{ dir + "thread_siblings_list" };
+		if (not (package >> cpu.package) or not (core >> cpu.core)) continue;
+
+		// "0,32" or "0-1": the first listed cpu is sibling 0
+		int first{ i };
+		if (siblings >> first and first != i) cpu.sibling = 1;
+#endif
+		cpus.push_back(cpu);
+	}
+
+	return cpus;
+}
+
+// Logical cpus in the order the workers are placed on them.
+//   compact : one thread per physical core, socket 0 first, SMT siblings last
+//   scatter : one thread per physical core, round-robin over sockets, SMT siblings last
+//   smt     : both hardware threads of a core before moving to the next core
+// Without a Linux topology every cpu is its own core and the orders coincide.
+inline std::vector<int> cpu_order(PLACEMENT placement)
+{
+	auto cpus = cpu_topology();
+
+	std::vector<int> core_rank(cpus.size());
+	for (size_t i = 0; i < cpus.size(); ++i) {
+		// index of the core inside its package, for round-robin placement
+		std::vector<int> cores;
+		for (auto& c : cpus) {
+			if (c.package == cpus[i].package and c.sibling == 0) cores.push_back(c.core);
+		}
+		std::sort(cores.begin(), cores.end());
+		core_rank[i] = static_cast<int>(std::lower_bound(cores.begin(), cores.end(), cpus[i].core) - cores.begin());
+	}
+
+	std::vector<int> index(cpus.size());
+	for (size_t i = 0; i < index.size(); ++i) index[i] = static_cast<int>(i);
+
+	std::stable_sort(index.begin(), index.end(), [&](int a, int b) {
+		auto& x = cpus[a];
+		auto& y = cpus[b];
+		switch (placement) {
+		case PLACEMENT::SCATTER:
+			if (x.sibling != y.sibling) return x.sibling < y.sibling;
+			if (core_rank[a] != core_rank[b]) return core_rank[a] < core_rank[b];
+			return x.package < y.package;
+		case PLACEMENT::SMT:
+			if (x.package != y.package) return x.package < y.package;
+			if (x.core != y.core) return x.core < y.core;
+			return x.sibling < y.sibling;
+		default:
+			if (x.sibling != y.sibling) return x.sibling < y.sibling;
+			if (x.package != y.package) return x.package < y.package;
+			return x.core < y.core;
+		}
+	});
+
+	std::vector<int> order;
+	for (int i : index) order.push_back(cpus[i].id);
+	return order;
+}
+
+inline bool pin_thread(int cpu)
+{
+#if defined(_WIN32)
+	if (cpu >= 64) return false;
+	return 0 != SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{ 1 } << cpu);
+#elif defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return 0 == pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+	(void)cpu;
+	return false;
+#endif
+}
+
+// Pins a thread other than the caller, e.g. a set's own server thread.
+inline bool pin_thread(std::thread& th, int cpu)
+{
+#if defined(_WIN32)
+	if (cpu >= 64) return false;
+	return 0 != SetThreadAffinityMask(th.native_handle(), DWORD_PTR{ 1 } << cpu);
+#elif defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return 0 == pthread_setaffinity_np(th.native_handle(), sizeof(set), &set);
+#else
+	(void)th;
+	(void)cpu;
+	return false;
+#endif
+}
+
+// Persistent, optionally pinned benchmark threads. A job runs on the first n
+// workers; it calls start_line() once its setup is done and finish_line() when
+// its measured phase ends. run() returns the time from the moment the last
+// worker reached the start line until the last worker crossed the finish line,
+// so thread creation, setup and teardown stay out of the measurement.
+class WorkerPool {
+public:
+	WorkerPool(int num_workers, PLACEMENT placement)
+	{
+		if (placement != PLACEMENT::NONE) cpus = cpu_order(placement);
+
+		for (int i = 0; i < num_workers; ++i) {
+			workers.emplace_back(&WorkerPool::worker, this, i);
+		}
+	}
+
+	~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lg{ mtx };
+			stop = true;
+		}
+		work_cv.notify_all();
+
+		for (auto& th : workers) th.join();
+	}
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	int size() const { return static_cast<int>(workers.size()); }
+
+	int cpu_of(int worker_id) const
+	{
+		if (cpus.empty()) return -1;
+		return cpus[worker_id % cpus.size()];
+	}
+
+	// The cpus the first n workers leave free, in placement order. Unpinned
+	// workers are counted as if placed compactly.
+	std::vector<int> free_cpus(int n) const
+	{
+		auto order = cpus.empty() ? cpu_order(PLACEMENT::COMPACT) : cpus;
+		if (n >= static_cast<int>(order.size())) return {};
+		return { order.begin() + n, order.end() };
+	}
+
+	std::chrono::duration<double> run(int n, const std::function<void(int)>& job)
+	{
+		std::unique_lock<std::mutex> lk{ mtx };
+		current_job = &job;
+		active = n;
+		exited = 0;
+		ready = 0;
+		finished = 0;
+		go = false;
+		++generation;
+		work_cv.notify_all();
+
+		done_cv.wait(lk, [&] { return exited == active; });
+		current_job = nullptr;
+
+		return end - start;
+	}
+
+	void start_line()
+	{
+		if (ready.fetch_add(1) + 1 == active) {
+			start = std::chrono::high_resolution_clock::now();
+			go.store(true, std::memory_order_release);
+			return;
+		}
+
+		while (not go.load(std::memory_order_acquire)) {
+			std::this_thread::yield();
+		}
+	}
+
+	// The clock is read after the count, by the worker that completes it; a
+	// worker preempted between its own clock read and the count could
+	// otherwise end the measurement before the others had finished.
+	void finish_line()
+	{
+		if (finished.fetch_add(1) + 1 == active) {
+			end = std::chrono::high_resolution_clock::now();
+		}
+	}
+
+private:
+	void worker(int id)
+	{
+		if (not cpus.empty()) pin_thread(cpu_of(id));
+		threadId = id;
+
+		int seen{ 0 };
+		while (true) {
+			const std::function<void(int)>* job;
+			{
+				std::unique_lock<std::mutex> lk{ mtx };
+				work_cv.wait(lk, [&] { return stop or generation != seen; });
+				if (stop) return;
+				seen = generation;
+				if (id >= active) continue;
+				job = current_job;
+			}
+
+			(*job)(id);
+
+			std::lock_guard<std::mutex> lg{ mtx };
+			if (++exited == active) done_cv.notify_one();
+		}
+	}
+
+private:
+	std::vector<std::thread> workers;
+	std::vector<int> cpus;
+
+	std::mutex mtx;
+	std::condition_variable work_cv;
+	std::condition_variable done_cv;
+	int generation{ 0 };
+	int active{ 0 };
+	int exited{ 0 };
+	bool stop{ false };
+	const std::function<void(int)>* current_job{ nullptr };
+
+	alignas(64) std::atomic<int> ready{ 0 };
+	alignas(64) std::atomic<int> finished{ 0 };
+	alignas(64) std::atomic<bool> go{ false };
+	std::chrono::high_resolution_clock::time_point start;
+	std::chrono::high_resolution_clock::time_point end;
+};
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+#include <thread>
+#include <functional>
+
+enum OP_TYPE { OP_ADD, OP_REMOVE, OP_CONTAINS };
+
+enum class KEY_DIST { UNIFORM, ZIPF, HOTSPOT };
+
+struct OP {
+	int op;
+	int value;
+};
+
+class FastRand { // xorshift64*, one per thread instead of the locked rand()
+public:
+	FastRand(unsigned long long seed = 0)
+	{
+		// splitmix64 so that neighbouring seeds give unrelated streams
+		seed += 0x9E3779B97F4A7C15ULL;
+		seed = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		seed = (seed ^ (seed >> 27)) * 0x94D049BB133111EBULL;
+		state = (seed ^ (seed >> 31)) | 1;
+	}
+
+	unsigned long long next()
+	{
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return state * 0x2545F4914F6CDD1DULL;
+	}
+
+	int next(int bound) // [0, bound)
+	{
+		return static_cast<int>(((next() >> 32) * static_cast<unsigned long long>(bound)) >> 32);
+	}
+
+	double uniform() // [0, 1)
+	{
+		return (next() >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+private:
+	unsigned long long state;
+};
+
+inline FastRand& thread_rand()
+{
+	thread_local FastRand rng{ std::hash<std::thread::id>{}(std::this_thread::get_id()) };
+	return rng;
+}
+
+class ZipfGenerator { // Gray et al., "Quickly Generating Billion-Record Synthetic Databases"
+public:
+	ZipfGenerator(int n = 1, double theta = 0.99) : n(n), theta(theta)
+	{
+		zetan = zeta(n, theta);
+		alpha = 1.0 / (1.0 - theta);
+		eta = (1.0 - std::pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta(2, theta) / zetan);
+		half_pow_theta = 1.0 + std::pow(0.5, theta);
+	}
+
+	int next(FastRand& rng) const // rank in [0, n), 0 is the hottest
+	{
+		double u = rng.uniform();
+		double uz = u * zetan;
+
+		if (uz < 1.0) return 0;
+		if (uz < half_pow_theta) return 1;
+
+		int rank = static_cast<int>(n * std::pow(eta * u - eta + 1.0, alpha));
+		return rank < n ? rank : n - 1;
+	}
+
+private:
+	static double zeta(int n, double theta)
+	{
+		double sum{ 0.0 };
+		for (int i = 1; i <= n; ++i) sum += 1.0 / std::pow(i, theta);
+		return sum;
+	}
+
+private:
+	int n;
+	double theta;
+	double zetan;
+	double alpha;
+	double eta;
+	double half_pow_theta;
+};
+
+struct WorkloadConfig {
+	int range{ 1'000 };
+	int addRatio{ 1 };
+	int removeRatio{ 1 };
+	int containsRatio{ 1 };
+	KEY_DIST dist{ KEY_DIST::UNIFORM };
+	double zipfTheta{ 0.99 };
+	double hotKeys{ 0.1 };  // fraction of the key range that is hot
+	double hotOps{ 0.9 };   // fraction of the operations that go to the hot keys
+	double fill{ -1.0 };    // preload fraction, negative means add / (add + remove)
+	bool shuffle{ false };  // preload in random order instead of descending
+	unsigned long long seed{ 0 };
+};
+
+class Workload {
+public:
+	Workload(const WorkloadConfig& config) : config(config)
+	{
+		if (config.dist == KEY_DIST::ZIPF) {
+			zipf = ZipfGenerator{ config.range, config.zipfTheta };
+		}
+
+		// Hot ranks are scattered over the key space by an affine permutation,
+		// otherwise the hottest keys would all sit next to the list head.
+		const long long n{ config.range };
+		multiplier = 2'654'435'761LL % n;
+		if (multiplier == 0) multiplier = 1;
+		while (std::gcd(multiplier, n) != 1) ++multiplier;
+		offset = 40'503LL % n;
+	}
+
+	double fill() const
+	{
+		if (config.fill >= 0.0) return config.fill;
+		if (config.addRatio + config.removeRatio == 0) return 0.5;
+		return static_cast<double>(config.addRatio) / (config.addRatio + config.removeRatio);
+	}
+
+	// Keys to insert before timing starts, in descending order so that
+	// sorted lists insert at the head, or shuffled for unbalanced trees.
+	std::vector<int> preload_keys() const
+	{
+		FastRand rng{ config.seed ^ 0x5EED5EED };
+		const double f{ fill() };
+
+		std::vector<int> keys;
+		keys.reserve(static_cast<size_t>(config.range * f) + 1);
+		for (int v = config.range - 1; v >= 0; --v) {
+			if (rng.uniform() < f) keys.push_back(v);
+		}
+
+		if (config.shuffle) {
+			for (size_t i = keys.size(); i > 1; --i) std::swap(keys[i - 1], keys[rng.next(static_cast<int>(i))]);
+		}
+
+		return keys;
+	}
+
+	std::vector<OP> generate(int thread_id, int count) const
+	{
+		FastRand rng{ config.seed * MAX_STREAMS + thread_id + 1 };
+		const int MIX{ config.addRatio + config.removeRatio + config.containsRatio };
+
+		std::vector<OP> ops(count);
+		for (auto& o : ops) {
+			int r = rng.next(MIX);
+			if (r < config.addRatio) o.op = OP_ADD;
+			else if (r < config.addRatio + config.removeRatio) o.op = OP_REMOVE;
+			else o.op = OP_CONTAINS;
+
+			o.value = next_key(rng);
+		}
+
+		return ops;
+	}
+
+	int next_key(FastRand& rng) const
+	{
+		switch (config.dist) {
+		case KEY_DIST::ZIPF:
+			return scatter(zipf.next(rng));
+		case KEY_DIST::HOTSPOT: {
+			int hot = static_cast<int>(config.range * config.hotKeys);
+			if (hot < 1) hot = 1;
+			if (hot >= config.range or rng.uniform() < config.hotOps) {
+				return scatter(rng.next(hot));
+			}
+			return scatter(hot + rng.next(config.range - hot));
+		}
+		default:
+			return rng.next(config.range);
+		}
+	}
+
+private:
+	int scatter(int rank) const
+	{
+		return static_cast<int>((rank * multiplier + offset) % config.range);
+	}
+
+private:
+	static constexpr int MAX_STREAMS{ 1'024 };
+
+	WorkloadConfig config;
+	ZipfGenerator zipf;
+	long long multiplier;
+	long long offset;
+};
+
+inline bool parse_dist(const std::string& name, KEY_DIST& dist)
+{
+	if (name == "uniform") dist = KEY_DIST::UNIFORM;
+	else if (name == "zipf") dist = KEY_DIST::ZIPF;
+	else if (name == "hotspot") dist = KEY_DIST::HOTSPOT;
+	else return false;
+	return true;
+}
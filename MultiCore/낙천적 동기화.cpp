@@ -1,205 +1,10 @@
 #include <iostream>
 #include <thread>
-#include <mutex>
 #include <chrono>
 #include <vector>
 
-const int MAX_THREADS{ 32 };
-
-class NODE {
-public:
-	int value;
-	NODE* next;
-	std::mutex mtx;
-
-	NODE(int v) : next(nullptr), value(v) {}
-
-	void lock() { mtx.lock(); }
-	void unlock() { mtx.unlock(); }
-};
-
-class O_SET {
-public:
-	O_SET()
-	{
-		head = new NODE(std::numeric_limits<int>::min());
-		tail = new NODE(std::numeric_limits<int>::max());
-		head->next = tail;
-	}
-
-	~O_SET()
-	{
-		clear();
-		delete head;
-		delete tail;
-	}
-
-	void clear()
-	{
-		NODE* curr = head->next;
-		while (curr != tail) {
-			NODE* temp = curr;
-			curr = curr->next;
-			delete temp;
-		}
-
-		head->next = tail;
-	}
-
-	bool add(int v)
-	{
-		while(true) {
-			auto prev = head;
-			auto curr = prev->next;
-
-			while (curr->value < v) {
-				prev = curr;
-				curr = curr->next;
-			}
-
-			prev->lock();
-			curr->lock();
-			if (false == validate(v, prev, curr)) {
-				prev->unlock();
-				curr->unlock();
-				continue;
-			}
-
-			if (curr->value == v) {
-				prev->unlock();
-				curr->unlock();
-
-				return false;
-			}
-
-			else {
-				auto newNode = new NODE(v);
-				newNode->next = curr;
-				prev->next = newNode;
-
-				prev->unlock();
-				curr->unlock();
-
-				return true;
-			}
-		}
-	}
-
-	bool remove(int v)
-	{
-		while (true) {
-			auto prev = head;
-			auto curr = prev->next;
-
-			while (curr->value < v) {
-				prev = curr;
-				curr = curr->next;
-			}
-
-			prev->lock();
-			curr->lock();
-			if (false == validate(v, prev, curr)) {
-				prev->unlock();
-				curr->unlock();
-				continue;
-			}
-
-			if (curr->value == v) {
-				prev->next = curr->next;
-
-				prev->unlock();
-				curr->unlock();
-
-				return true;
-			}
-
-			else {
-				prev->unlock();
-				curr->unlock();
-
-				return false;
-			}
-		}
-	}
-
-	bool contains(int v)
-	{
-		while (true) {
-			auto prev = head;
-			auto curr = prev->next;
-
-			while (curr->value < v) {
-				prev = curr;
-				curr = curr->next;
-			}
-
-			prev->lock();
-			curr->lock();
-			if (false == validate(v, prev, curr)) {
-				prev->unlock();
-				curr->unlock();
-				continue;
-			}
-
-			if (curr->value == v) {
-				prev->unlock();
-				curr->unlock();
-
-				return true;
-			}
-
-			else {
-				prev->unlock();
-				curr->unlock();
-
-				return false;
-			}
-		}
-	}
-
-	void print20()
-	{
-		auto curr = head->next;
-
-		for (int i = 0; i < 20 and curr != tail; ++i) {
-			std::cout << curr->value << ", ";
-			curr = curr->next;
-		}
-		std::cout << std::endl;
-	}
-
-private:
-	bool validate(int v, NODE* p, NODE* c)
-	{
-		auto prev = head;
-		auto curr = prev->next;
-
-		while (curr->value < v) {
-			prev = curr;
-			curr = curr->next;
-		}
-			
-		return ((prev == p) && (curr == c));
-
-		/*{
-			NODE* node = head;
-
-			while (node->value <= p->value) {
-				if(node == p){
-					return p->next = c;
-				}
-
-				node = node->next;
-			}
-
-			return false;
-		}*/
-	}
-
-private:
-	NODE* head;
-	NODE* tail;
-};
+#include "O_SET.h"
+#include "Workload.h"
 
 O_SET set;
 
@@ -209,8 +14,8 @@ void benchmark(const int num_threads)
 	const int RANGE{ 1'000 };
 
 	for (int i = 0; i < LOOP_COUNT; ++i) {
-		int value = rand() % RANGE;
-		int op = rand() % 3;
+		int value = thread_rand().next(RANGE);
+		int op = thread_rand().next(3);
 
 		if (op == 0) set.add(value);
 		else if (op == 1) set.remove(value);
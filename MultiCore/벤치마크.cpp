@@ -0,0 +1,1027 @@
+#include <iostream>
+#include <iomanip>
+#include <array>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <memory>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <type_traits>
+
+#include "C_SET.h"
+#include "D_SET.h"
+#include "F_SET.h"
+#include "O_SET.h"
+#include "L_SET.h"
+#include "L_SKIP_SET.h"
+#include "LF_SET.h"
+#include "LF_SKIP_SET.h"
+#include "LF_BST_SET.h"
+#include "AVL_SET.h"
+#include "SO_HASH_SET.h"
+#include "RCU_SET.h"
+#include "U_SET.h"
+#include "BITMAP_SET.h"
+#include "SHARD_SET.h"
+#include "Workload.h"
+#include "Clock.h"
+#include "Histogram.h"
+#include "PerfCounter.h"
+#include "WorkerPool.h"
+#include "Checker.h"
+#include "Linearizability.h"
+#include "OpStats.h"
+#include "Statistics.h"
+#include "LockTrace.h"
+#include "Fairness.h"
+
+struct Config {
+	std::vector<std::string> sets{ "all" };
+	std::vector<int> threads{ 1, 2, 4, 8, 16, 32 };
+	WorkloadConfig workload;
+	int loop{ 4'000'000 };
+	int duration{ 0 }; // ms; 0 runs a fixed number of operations
+	bool latency{ false };
+	bool perf{ false };
+	unsigned long long perfRaw{ 0 };
+	PLACEMENT placement{ PLACEMENT::COMPACT };
+	bool check{ false };
+	bool linearizability{ false };
+	int reps{ 1 };
+	int warmup{ 0 };
+	std::string json;
+	std::string csv;
+	std::vector<std::string> compare;
+	std::string trace;
+};
+
+const char* OP_NAMES[]{ "add", "remove", "contains" };
+
+struct alignas(64) ThreadResult {
+	std::array<Histogram, 3> latency;
+	PerfSample perf;
+	std::vector<EVENT> history;
+	long long ops{ 0 };
+	unsigned long long longest{ 0 };
+};
+
+struct RunResult {
+	int num_threads{ 0 };
+	long long ops{ 0 };           // per repetition
+	std::vector<double> ms{};     // one per measured repetition
+	std::vector<double> samples{}; // Mops/s, one per measured repetition
+	long long total_ops{ 0 };     // over all measured repetitions
+	Summary mops{};
+	FairnessResult fairness{};    // duration mode only
+	std::array<Histogram, 3> latency{};
+	PerfSample perf{};
+	std::string check{};
+	std::string linearizability{};
+	StatBlock stats{};
+};
+
+template <class SET>
+inline bool do_op(SET* set, const OP& o)
+{
+	if (o.op == OP_ADD) return set->add(o.value);
+	else if (o.op == OP_REMOVE) return set->remove(o.value);
+	else return set->contains(o.value);
+}
+
+template <bool LATENCY, bool CHECK, bool HISTORY, class SET>
+void run_ops(SET* set, const std::vector<OP>& ops,
+	ThreadResult* result, ConsistencyChecker* checker)
+{
+	for (auto& o : ops) {
+		unsigned long long t0{ 0 };
+		if constexpr (HISTORY) t0 = invoke_ticks();
+		else if constexpr (LATENCY) t0 = ticks();
+
+		bool r = do_op(set, o);
+
+		if constexpr (HISTORY) {
+			auto t1 = response_ticks();
+			result->history.push_back({ t0, t1, o.value, o.op, r });
+			if constexpr (LATENCY) result->latency[o.op].record(t1 - t0);
+		}
+		else if constexpr (LATENCY) result->latency[o.op].record(ticks() - t0);
+
+		if constexpr (CHECK) checker->record(o.op, o.value, r);
+	}
+}
+
+// Duration mode: cycles through the stream until the deadline and counts the
+// operations and the longest one.
+template <bool LATENCY, bool CHECK, class SET>
+void run_until(SET* set, const std::vector<OP>& ops, unsigned long long deadline,
+	ThreadResult* result, ConsistencyChecker* checker)
+{
+	if (ops.empty()) return;
+
+	size_t i{ 0 };
+	long long count{ 0 };
+	unsigned long long longest{ 0 };
+
+	auto t0 = ticks();
+	while (t0 < deadline) {
+		auto& o = ops[i];
+		bool r = do_op(set, o);
+
+		auto t1 = ticks();
+		longest = std::max(longest, t1 - t0);
+		if constexpr (LATENCY) result->latency[o.op].record(t1 - t0);
+		if constexpr (CHECK) checker->record(o.op, o.value, r);
+
+		// the bookkeeping above is not part of the next operation
+		if constexpr (LATENCY or CHECK) t1 = ticks();
+
+		t0 = t1;
+		++count;
+		if (++i == ops.size()) i = 0;
+	}
+
+	result->ops = count;
+	result->longest = longest;
+}
+
+// Sets that take requests asynchronously (D_SET): post() queues an operation
+// whose result arrives later and wait() returns once the caller's are done.
+template <class SET>
+constexpr bool POSTS = requires(SET* set, bool* r) { set->post(OP_ADD, 0, r); set->wait(); };
+
+// run_ops for posting sets: the stream goes in windows of SET::WINDOW
+// operations, every one posted before the window is waited for. An
+// operation's response is the end of its window, so the latency is the
+// window's and the history intervals of a window overlap.
+template <bool LATENCY, bool CHECK, bool HISTORY, class SET>
+void post_ops(SET* set, const std::vector<OP>& ops,
+	ThreadResult* result, ConsistencyChecker* checker)
+{
+	bool results[SET::WINDOW];
+	unsigned long long invoked[SET::WINDOW]{};
+
+	for (size_t begin = 0; begin < ops.size(); begin += SET::WINDOW) {
+		const size_t n = std::min(ops.size() - begin, static_cast<size_t>(SET::WINDOW));
+
+		for (size_t j = 0; j < n; ++j) {
+			auto& o = ops[begin + j];
+			if constexpr (HISTORY) invoked[j] = invoke_ticks();
+			else if constexpr (LATENCY) invoked[j] = ticks();
+
+			set->post(static_cast<OP_TYPE>(o.op), o.value, &results[j]);
+		}
+		set->wait();
+
+		unsigned long long t1{ 0 };
+		if constexpr (HISTORY) t1 = response_ticks();
+		else if constexpr (LATENCY) t1 = ticks();
+
+		for (size_t j = 0; j < n; ++j) {
+			auto& o = ops[begin + j];
+			if constexpr (HISTORY) result->history.push_back({ invoked[j], t1, o.value, o.op, results[j] });
+			if constexpr (LATENCY) result->latency[o.op].record(t1 - invoked[j]);
+			if constexpr (CHECK) checker->record(o.op, o.value, results[j]);
+		}
+	}
+}
+
+// run_until for posting sets, a window at a time; the longest operation is
+// the longest window.
+template <bool LATENCY, bool CHECK, class SET>
+void post_until(SET* set, const std::vector<OP>& ops, unsigned long long deadline,
+	ThreadResult* result, ConsistencyChecker* checker)
+{
+	if (ops.empty()) return;
+
+	bool results[SET::WINDOW];
+	size_t i{ 0 };
+	long long count{ 0 };
+	unsigned long long longest{ 0 };
+
+	auto t0 = ticks();
+	while (t0 < deadline) {
+		const size_t first{ i };
+		for (int j = 0; j < SET::WINDOW; ++j) {
+			set->post(static_cast<OP_TYPE>(ops[i].op), ops[i].value, &results[j]);
+			if (++i == ops.size()) i = 0;
+		}
+		set->wait();
+
+		auto t1 = ticks();
+		longest = std::max(longest, t1 - t0);
+
+		if constexpr (LATENCY or CHECK) {
+			for (int j = 0; j < SET::WINDOW; ++j) {
+				auto& o = ops[(first + j) % ops.size()];
+				if constexpr (LATENCY) result->latency[o.op].record(t1 - t0);
+				if constexpr (CHECK) checker->record(o.op, o.value, results[j]);
+			}
+
+			// the bookkeeping above is not part of the next window
+			t1 = ticks();
+		}
+
+		t0 = t1;
+		count += SET::WINDOW;
+	}
+
+	result->ops = count;
+	result->longest = longest;
+}
+
+// Turns a runtime flag into std::true_type / std::false_type for f
+template <class F>
+void with_flag(bool flag, F&& f)
+{
+	if (flag) f(std::true_type{});
+	else f(std::false_type{});
+}
+
+template <class SET>
+void benchmark(SET* set, const std::vector<OP>* ops, const int thread_id,
+	const Config* config, ThreadResult* result, ConsistencyChecker* checker, WorkerPool* pool)
+{
+	threadId = thread_id;
+
+	std::unique_ptr<PerfCounter> perf;
+	if (config->perf) perf = std::make_unique<PerfCounter>(config->perfRaw);
+	if (config->linearizability) result->history.reserve(ops->size());
+	stat_blocks[thread_id] = {};
+
+	pool->start_line();
+	if (perf) perf->start();
+
+	if (config->duration > 0) {
+		const auto deadline = ticks() + static_cast<unsigned long long>(config->duration * 1e6 / ns_per_tick());
+		with_flag(config->latency, [&](auto latency) {
+			with_flag(checker != nullptr, [&](auto check) {
+				if constexpr (POSTS<SET>) post_until<latency(), check()>(set, *ops, deadline, result, checker);
+				else run_until<latency(), check()>(set, *ops, deadline, result, checker);
+				});
+			});
+	}
+	else {
+		with_flag(config->latency, [&](auto latency) {
+			with_flag(checker != nullptr, [&](auto check) {
+				with_flag(config->linearizability, [&](auto history) {
+					if constexpr (POSTS<SET>) post_ops<latency(), check(), history()>(set, *ops, result, checker);
+					else run_ops<latency(), check(), history()>(set, *ops, result, checker);
+					});
+				});
+			});
+	}
+
+	pool->finish_line();
+	if (perf) result->perf = perf->stop();
+}
+
+template <class SET>
+std::vector<int> preload(SET& set, const Workload& workload, ConsistencyChecker* checker)
+{
+	threadId = 0;
+
+	std::vector<int> keys;
+	for (int v : workload.preload_keys()) {
+		bool r = set.add(v);
+		if (checker) checker->record(OP_ADD, v, r);
+		if (r) keys.push_back(v);
+	}
+
+	return keys;
+}
+
+// A set built for a key range (BITMAP_SET, D_SET) takes it as its
+// constructor's int, so it always covers the workload's keys.
+template <class SET>
+std::unique_ptr<SET> make_set(const Config& config)
+{
+	if constexpr (std::is_constructible_v<SET, int>) return std::make_unique<SET>(config.workload.range);
+	else return std::make_unique<SET>();
+}
+
+template <class SET>
+std::vector<RunResult> run_set(const char* name, const Config& config, WorkerPool& pool)
+{
+	using namespace std::chrono;
+
+	std::vector<RunResult> results;
+	Workload workload{ config.workload };
+
+	std::unique_ptr<ConsistencyChecker> checker;
+	if (config.check) checker = std::make_unique<ConsistencyChecker>(config.workload.range);
+
+	for (int num_threads : config.threads) {
+		num_thread = num_threads;
+
+		std::vector<std::vector<OP>> streams(num_threads);
+		for (int i = 0; i < num_threads; ++i) {
+			streams[i] = workload.generate(i, config.loop / num_threads);
+		}
+
+		RunResult r{ num_threads, static_cast<long long>(config.loop / num_threads) * num_threads };
+
+		// Warm-up runs are timed the same way and thrown away. Every run starts
+		// from a fresh, identically preloaded set and replays the same streams.
+		for (int rep = 0; rep < config.warmup + config.reps; ++rep) {
+			const bool measured{ rep >= config.warmup };
+
+			auto set = make_set<SET>(config);
+			// a set's own server threads get the cpus this run's workers leave free
+			if constexpr (requires { set->pin_servers(pool.free_cpus(num_threads)); }) set->pin_servers(pool.free_cpus(num_threads));
+			if (checker) checker->clear();
+			auto initial = preload(*set, workload, checker.get());
+
+			std::vector<ThreadResult> thread_results(num_threads);
+
+			// the lock timeline of the last repetition goes to PREFIX-SET-THREADS.json
+			const bool trace{ not config.trace.empty() and rep + 1 == config.warmup + config.reps };
+			if (trace) lock_tracer.start();
+
+			auto elapsed = pool.run(num_threads, [&](int id) {
+				benchmark(set.get(), &streams[id], id, &config, &thread_results[id], checker.get(), &pool);
+				});
+
+			if (trace) {
+				lock_tracer.stop();
+				auto path = config.trace + "-" + name + "-" + std::to_string(num_threads) + ".json";
+				if (false == lock_tracer.write_chrome_trace(path)) std::cout << "Cannot write " << path << "\n";
+			}
+
+			if (not measured) continue;
+
+			const double ms{ duration<double, std::milli>(elapsed).count() };
+			r.ms.push_back(ms);
+
+			long long ops{ r.ops };
+			if (config.duration > 0) {
+				FairnessResult f;
+				f.ms = ms;
+				for (auto& tr : thread_results) {
+					f.ops.push_back(tr.ops);
+					f.longest = std::max(f.longest, tr.longest);
+				}
+				ops = f.total();
+				r.fairness.merge(f);
+			}
+			r.total_ops += ops;
+			r.samples.push_back(ops / ms / 1'000.0);
+
+			for (auto& tr : thread_results) {
+				for (int op = 0; op < 3; ++op) r.latency[op].merge(tr.latency[op]);
+				r.perf.merge(tr.perf);
+			}
+
+			for (int i = 0; i < num_threads; ++i) {
+				for (int c = 0; c < STAT_COUNTERS; ++c) r.stats.counter[c] += stat_blocks[i].counter[c];
+			}
+
+			// the first failure of any repetition is reported
+			if (checker and (r.check.empty() or r.check == "OK")) {
+				r.check = "OK";
+				std::string error;
+				if (false == checker->check(*set, num_threads, error)) r.check = error;
+			}
+
+			if (config.linearizability and (r.linearizability.empty() or r.linearizability.rfind("OK", 0) == 0)) {
+				// the count is this repetition's history only
+				std::vector<std::vector<EVENT>*> histories;
+				long long events{ 0 };
+				for (auto& tr : thread_results) {
+					histories.push_back(&tr.history);
+					events += tr.history.size();
+				}
+
+				const int checkers = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+				std::string error;
+				LinearizabilityChecker lin;
+				auto lr = lin.check(histories, initial, config.workload.range, checkers, error);
+				r.linearizability = (lr == LIN_RESULT::OK) ? "OK (" + std::to_string(events) + " ops)" : error;
+			}
+		}
+
+		r.ops = r.total_ops / config.reps;
+		r.mops = summarize(r.samples);
+
+		results.push_back(r);
+	}
+
+	return results;
+}
+
+struct SetEntry {
+	const char* name;
+	std::vector<RunResult>(*run)(const char*, const Config&, WorkerPool&);
+};
+
+const SetEntry SETS[]{
+	{ "C_SET", run_set<C_SET> },
+	{ "C_SET_FC", run_set<C_SET_FC> },
+	{ "C_SET_SEQ", run_set<C_SET_SEQ> },
+	{ "D_SET_1", run_set<D_SET<1>> },
+	{ "D_SET_2", run_set<D_SET<2>> },
+	{ "D_SET", run_set<D_SET<4>> },
+	{ "D_SET_8", run_set<D_SET<8>> },
+	{ "F_SET", run_set<F_SET> },
+	{ "F_SET_OLC", run_set<F_SET_OLC> },
+	{ "O_SET", run_set<O_SET> },
+	{ "L_SET", run_set<L_SET> },
+	{ "L_SET_FL", run_set<L_SET_FL> },
+	{ "L_SET_SP", run_set<L_SET_SP> },
+	{ "L_SET_ATOMIC_SP", run_set<L_SET_ATOMIC_SP> },
+	{ "L_SKIP_SET", run_set<L_SKIP_SET> },
+	{ "LF_SET", run_set<LF_SET> },
+	{ "LF_SET_EBR", run_set<LF_SET_EBR> },
+	{ "LF_SKIP_SET", run_set<LF_SKIP_SET> },
+	{ "LF_BST_SET", run_set<LF_BST_SET> },
+	{ "AVL_SET", run_set<AVL_SET> },
+	{ "SO_HASH_SET", run_set<SO_HASH_SET> },
+	{ "RCU_SET", run_set<RCU_SET> },
+	{ "U_SET", run_set<U_SET> },
+	{ "BITMAP_SET", run_set<BITMAP_SET> },
+	{ "SHARD_C_SET", run_set<SHARD_SET<C_SET>> },
+	{ "SHARD_L_SET", run_set<SHARD_SET<L_SET>> },
+	{ "SHARD_LF_SET_EBR", run_set<SHARD_SET<LF_SET_EBR>> },
+};
+
+void print_perf(const RunResult& r)
+{
+	bool any{ false };
+	for (bool v : r.perf.valid) any = any or v;
+	if (not any) return;
+
+	const double ops{ static_cast<double>(r.total_ops) };
+	std::cout << std::setw(33) << "per op" << std::setprecision(2);
+	for (int i = 0; i < PERF_EVENTS; ++i) {
+		if (not r.perf.valid[i]) continue;
+		std::cout << "  " << PERF_EVENT_NAMES[i] << " " << r.perf.value[i] / ops;
+	}
+	if (r.perf.valid[PERF_CYCLES] and r.perf.valid[PERF_INSTRUCTIONS] and r.perf.value[PERF_CYCLES] != 0) {
+		std::cout << "  IPC " << static_cast<double>(r.perf.value[PERF_INSTRUCTIONS]) / r.perf.value[PERF_CYCLES];
+	}
+	std::cout << "\n";
+}
+
+void print_stats(const RunResult& r)
+{
+#if defined(SET_STATS)
+	const double ops{ static_cast<double>(r.total_ops) };
+	std::cout << std::setw(33) << "per op" << std::setprecision(3);
+	for (int c = 0; c < STAT_COUNTERS; ++c) {
+		std::cout << "  " << STAT_NAMES[c] << " " << r.stats.counter[c] / ops;
+	}
+	std::cout << "\n";
+#else
+	(void)r;
+#endif
+}
+
+void print_table(const char* name, const std::vector<RunResult>& results)
+{
+	// Scaling is measured against the smallest thread count that was run
+	const RunResult& base = results.front();
+
+	for (auto& r : results) {
+		const double speedup{ r.mops.mean / base.mops.mean };
+		const double efficiency{ speedup * base.num_threads / r.num_threads };
+
+		double ms{ 0.0 };
+		for (double m : r.ms) ms += m;
+		ms /= r.ms.size();
+
+		std::cout << std::left << std::setw(18) << name << std::right
+			<< std::setw(8) << r.num_threads
+			<< std::setw(12) << std::fixed << std::setprecision(0) << ms
+			<< std::setw(12) << std::setprecision(3) << r.mops.mean;
+		if (r.mops.n > 1) std::cout << std::setw(10) << r.mops.ci95;
+		std::cout << std::setw(10) << std::setprecision(2) << speedup
+			<< std::setw(11) << std::setprecision(1) << efficiency * 100.0 << "%\n";
+
+		for (int op = 0; op < 3; ++op) {
+			auto& h = r.latency[op];
+			if (h.count() == 0) continue;
+
+			auto ns = [&](unsigned long long t) { return static_cast<long long>(t * ns_per_tick()); };
+			std::cout << std::setw(28) << OP_NAMES[op] << " (ns)"
+				<< "  p50 " << ns(h.percentile(50.0))
+				<< "  p90 " << ns(h.percentile(90.0))
+				<< "  p99 " << ns(h.percentile(99.0))
+				<< "  p99.9 " << ns(h.percentile(99.9))
+				<< "  max " << ns(h.max()) << "\n";
+		}
+
+		print_perf(r);
+		print_stats(r);
+
+		if (not r.fairness.ops.empty()) {
+			std::cout << std::setw(33) << "Fairness : ";
+			r.fairness.print(std::cout);
+			std::cout << "\n";
+		}
+
+		if (not r.check.empty()) {
+			std::cout << std::setw(33) << "Consistency : " << r.check << "\n";
+		}
+
+		if (not r.linearizability.empty()) {
+			std::cout << std::setw(33) << "Linearizability : " << r.linearizability << "\n";
+		}
+	}
+}
+
+std::vector<std::string> split(const std::string& s, char delim)
+{
+	std::vector<std::string> tokens;
+	std::stringstream ss{ s };
+	std::string token;
+
+	while (std::getline(ss, token, delim)) {
+		if (not token.empty()) tokens.push_back(token);
+	}
+
+	return tokens;
+}
+
+using Report = std::vector<std::pair<const char*, std::vector<RunResult>>>;
+
+const char* DIST_NAMES[]{ "uniform", "zipf", "hotspot" };
+const char* PLACEMENT_NAMES[]{ "none", "compact", "scatter", "smt" };
+
+std::string json_string(const std::string& s)
+{
+	std::string out{ "\"" };
+	for (char c : s) {
+		if (c == '"' or c == '\\') out += '\\';
+		if (c == '\n') out += "\\n";
+		else out += c;
+	}
+	return out + "\"";
+}
+
+bool write_json(const std::string& path, const Config& config, const Report& report)
+{
+	std::ofstream out{ path };
+	if (not out) return false;
+
+	auto& w = config.workload;
+	out << "{\n  \"workload\": { \"range\": " << w.range
+		<< ", \"mix\": [" << w.addRatio << ", " << w.removeRatio << ", " << w.containsRatio << "]"
+		<< ", \"dist\": " << json_string(DIST_NAMES[static_cast<int>(w.dist)])
+		<< ", \"fill\": " << Workload{ w }.fill()
+		<< ", \"shuffle\": " << (w.shuffle ? "true" : "false")
+		<< ", \"seed\": " << w.seed
+		<< ", \"ops\": " << config.loop << " },\n"
+		<< "  \"placement\": " << json_string(PLACEMENT_NAMES[static_cast<int>(config.placement)]) << ",\n"
+		<< "  \"reps\": " << config.reps << ",\n"
+		<< "  \"warmup\": " << config.warmup << ",\n"
+		<< "  \"results\": [";
+
+	bool first{ true };
+	for (auto& [name, results] : report) {
+		for (auto& r : results) {
+			const double ops{ static_cast<double>(r.total_ops) };
+
+			out << (first ? "\n" : ",\n") << "    { \"set\": " << json_string(name)
+				<< ", \"threads\": " << r.num_threads
+				<< ", \"ops\": " << r.ops
+				<< ", \"ms\": [";
+			for (size_t i = 0; i < r.ms.size(); ++i) out << (i ? ", " : "") << r.ms[i];
+			out << "], \"mops\": { \"mean\": " << r.mops.mean
+				<< ", \"stddev\": " << r.mops.stddev
+				<< ", \"ci95\": " << r.mops.ci95 << " }";
+			first = false;
+
+			bool any{ false };
+			for (int op = 0; op < 3; ++op) {
+				auto& h = r.latency[op];
+				if (h.count() == 0) continue;
+
+				auto ns = [&](unsigned long long t) { return static_cast<long long>(t * ns_per_tick()); };
+				out << (any ? ", " : ", \"latency_ns\": { ") << json_string(OP_NAMES[op])
+					<< ": { \"p50\": " << ns(h.percentile(50.0))
+					<< ", \"p90\": " << ns(h.percentile(90.0))
+					<< ", \"p99\": " << ns(h.percentile(99.0))
+					<< ", \"p99.9\": " << ns(h.percentile(99.9))
+					<< ", \"max\": " << ns(h.max()) << " }";
+				any = true;
+			}
+			if (any) out << " }";
+
+			any = false;
+			for (int i = 0; i < PERF_EVENTS; ++i) {
+				if (not r.perf.valid[i]) continue;
+				out << (any ? ", " : ", \"perf_per_op\": { ") << json_string(PERF_EVENT_NAMES[i])
+					<< ": " << r.perf.value[i] / ops;
+				any = true;
+			}
+			if (any) out << " }";
+
+#if defined(SET_STATS)
+			out << ", \"stats_per_op\": { ";
+			for (int c = 0; c < STAT_COUNTERS; ++c) {
+				out << (c ? ", " : "") << json_string(STAT_NAMES[c]) << ": " << r.stats.counter[c] / ops;
+			}
+			out << " }";
+#endif
+
+			if (not r.fairness.ops.empty()) {
+				out << ", \"fairness\": { \"thread_ops\": [";
+				for (size_t i = 0; i < r.fairness.ops.size(); ++i) out << (i ? ", " : "") << r.fairness.ops[i];
+				out << "], \"max_min\": " << r.fairness.max_min()
+					<< ", \"jain\": " << r.fairness.jain()
+					<< ", \"longest_ns\": " << static_cast<long long>(r.fairness.longest * ns_per_tick()) << " }";
+			}
+
+			if (not r.check.empty()) out << ", \"check\": " << json_string(r.check);
+			if (not r.linearizability.empty()) out << ", \"linearizability\": " << json_string(r.linearizability);
+			out << " }";
+		}
+	}
+	out << "\n  ]\n}\n";
+
+	return static_cast<bool>(out);
+}
+
+const char* CSV_HEADER{ "set,threads,range,mix,dist,reps,ops,mops_mean,mops_stddev,mops_ci95,mops_samples" };
+
+bool write_csv(const std::string& path, const Config& config, const Report& report)
+{
+	std::ofstream out{ path };
+	if (not out) return false;
+
+	auto& w = config.workload;
+	out << CSV_HEADER << "\n";
+	for (auto& [name, results] : report) {
+		for (auto& r : results) {
+			out << name << "," << r.num_threads << "," << w.range
+				<< "," << w.addRatio << "/" << w.removeRatio << "/" << w.containsRatio
+				<< "," << DIST_NAMES[static_cast<int>(w.dist)]
+				<< "," << r.ms.size() << "," << r.ops
+				<< "," << r.mops.mean << "," << r.mops.stddev << "," << r.mops.ci95 << ",";
+			for (size_t i = 0; i < r.samples.size(); ++i) out << (i ? " " : "") << r.samples[i];
+			out << "\n";
+		}
+	}
+
+	return static_cast<bool>(out);
+}
+
+struct CsvRow {
+	std::string set{};
+	int threads{ 0 };
+	Summary mops{};
+};
+
+// Reads the rows of a file written by --csv. Columns are looked up by name,
+// so files from older drivers with extra or reordered columns still load.
+bool read_csv(const std::string& path, std::vector<CsvRow>& rows)
+{
+	std::ifstream in{ path };
+	std::string line;
+	if (not std::getline(in, line)) return false;
+
+	auto header = split(line, ',');
+	auto column = [&](const char* name) {
+		return static_cast<int>(std::find(header.begin(), header.end(), name) - header.begin());
+	};
+	const int set = column("set"), threads = column("threads"), reps = column("reps");
+	const int mean = column("mops_mean"), stddev = column("mops_stddev"), ci95 = column("mops_ci95");
+	const int n = static_cast<int>(header.size());
+	if (set == n or threads == n or reps == n or mean == n or stddev == n) return false;
+
+	while (std::getline(in, line)) {
+		std::vector<std::string> fields;
+		std::stringstream ss{ line };
+		std::string field;
+		while (std::getline(ss, field, ',')) fields.push_back(field);
+		if (static_cast<int>(fields.size()) < n - 1) continue;
+		fields.resize(n);
+
+		try {
+			CsvRow row{ fields[set], std::stoi(fields[threads]) };
+			row.mops.n = std::stoi(fields[reps]);
+			row.mops.mean = std::stod(fields[mean]);
+			row.mops.stddev = std::stod(fields[stddev]);
+			if (ci95 != n) row.mops.ci95 = std::stod(fields[ci95]);
+			rows.push_back(row);
+		}
+		catch (const std::exception&) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Diffs two --csv files row by row (same set and thread count) and flags the
+// throughput changes a Welch t test finds significant at the 5% level.
+// Returns false if anything got significantly slower.
+bool compare(const std::string& base_path, const std::string& new_path)
+{
+	std::vector<CsvRow> base_rows, new_rows;
+	if (false == read_csv(base_path, base_rows)) {
+		std::cout << "Cannot read " << base_path << "\n";
+		return false;
+	}
+	if (false == read_csv(new_path, new_rows)) {
+		std::cout << "Cannot read " << new_path << "\n";
+		return false;
+	}
+
+	std::cout << "Base : " << base_path << ", New : " << new_path << "\n\n"
+		<< std::left << std::setw(18) << "Set" << std::right
+		<< std::setw(8) << "Threads"
+		<< std::setw(12) << "Base Mops/s"
+		<< std::setw(12) << "New Mops/s"
+		<< std::setw(10) << "Change"
+		<< std::setw(9) << "t"
+		<< "  Verdict\n";
+
+	bool ok{ true };
+	for (auto& b : base_rows) {
+		auto n = std::find_if(new_rows.begin(), new_rows.end(), [&](const CsvRow& r) {
+			return r.set == b.set and r.threads == b.threads;
+			});
+		if (n == new_rows.end()) continue;
+
+		auto w = welch(b.mops, n->mops);
+		const char* verdict{ "n/a (needs --reps >= 2)" };
+		if (b.mops.n >= 2 and n->mops.n >= 2) {
+			if (not w.significant) verdict = "same";
+			else if (n->mops.mean < b.mops.mean) verdict = "SLOWER";
+			else verdict = "faster";
+		}
+		if (w.significant and n->mops.mean < b.mops.mean) ok = false;
+
+		std::cout << std::left << std::setw(18) << b.set << std::right
+			<< std::setw(8) << b.threads
+			<< std::setw(12) << std::fixed << std::setprecision(3) << b.mops.mean
+			<< std::setw(12) << n->mops.mean
+			<< std::setw(9) << std::setprecision(1) << (n->mops.mean / b.mops.mean - 1.0) * 100.0 << "%"
+			<< std::setw(9) << std::setprecision(2) << w.t
+			<< "  " << verdict << "\n";
+	}
+
+	return ok;
+}
+
+void usage()
+{
+	std::cout << "Usage: MultiCore [options]\n"
+		<< "  --set=NAME[,NAME...]   set implementations to run, or 'all' (default: all)\n"
+		<< "  --threads=N[,N...]     thread counts (default: 1,2,4,8,16,32)\n"
+		<< "  --range=N              key range [0, N) (default: 1000)\n"
+		<< "  --mix=A/R/C            add/remove/contains ratio, e.g. 90/5/5 (default: 1/1/1)\n"
+		<< "  --dist=D               key distribution: uniform, zipf, hotspot (default: uniform)\n"
+		<< "  --zipf=THETA           zipf skew in (0, 1) (default: 0.99)\n"
+		<< "  --hot=K/O              hotspot: K% of the keys get O% of the ops (default: 10/90)\n"
+		<< "  --fill=F               preload fraction of the range, 0..1 (default: add / (add + remove))\n"
+		<< "  --shuffle              preload in random order instead of descending (for LF_BST_SET)\n"
+		<< "  --seed=N               workload seed (default: 0)\n"
+		<< "  --ops=N                total operations per run (default: 4000000)\n"
+		<< "  --duration=MS          run every thread for MS milliseconds instead, cycling through\n"
+		<< "                         its operations, and report per-thread fairness\n"
+		<< "  --pin=P                thread placement: none, compact, scatter, smt (default: compact)\n"
+		<< "  --latency              record per-operation latency histograms\n"
+		<< "  --check                verify the final set against per-key add/remove counts\n"
+		<< "  --linearizability      record invoke/response stamps and check every key's history\n"
+		<< "  --perf[=RAW]           read hardware counters per thread (Linux perf_event_open);\n"
+		<< "                         RAW is an optional PMU event code for cache-line transfers\n"
+		<< "  --reps=N               measured repetitions per thread count (default: 1)\n"
+		<< "  --warmup=N             discarded repetitions before the measured ones (default: 0)\n"
+		<< "  --json=FILE            write all results as JSON\n"
+		<< "  --csv=FILE             write the throughput results as CSV\n"
+		<< "  --compare=BASE,NEW     compare two CSV files and flag significant slowdowns, then exit\n"
+		<< "  --trace=PREFIX         write lock wait/hold timelines of the last repetition to\n"
+		<< "                         PREFIX-SET-THREADS.json (Chrome trace; needs a LOCK_TRACE build)\n"
+		<< "Sets :";
+	for (auto& entry : SETS) std::cout << " " << entry.name;
+	std::cout << std::endl;
+}
+
+bool parse_args(int argc, char* argv[], Config& config)
+{
+	for (int i = 1; i < argc; ++i) {
+		std::string arg{ argv[i] };
+		auto eq = arg.find('=');
+		std::string key = arg.substr(0, eq);
+		std::string value = (eq == std::string::npos) ? "" : arg.substr(eq + 1);
+
+		try {
+			if (key == "--set") {
+				config.sets = split(value, ',');
+			}
+			else if (key == "--threads") {
+				config.threads.clear();
+				for (auto& t : split(value, ',')) config.threads.push_back(std::stoi(t));
+			}
+			else if (key == "--range") {
+				config.workload.range = std::stoi(value);
+			}
+			else if (key == "--mix") {
+				auto ratio = split(value, '/');
+				if (ratio.size() != 3) return false;
+				config.workload.addRatio = std::stoi(ratio[0]);
+				config.workload.removeRatio = std::stoi(ratio[1]);
+				config.workload.containsRatio = std::stoi(ratio[2]);
+			}
+			else if (key == "--dist") {
+				if (false == parse_dist(value, config.workload.dist)) return false;
+			}
+			else if (key == "--zipf") {
+				config.workload.zipfTheta = std::stod(value);
+			}
+			else if (key == "--hot") {
+				auto ratio = split(value, '/');
+				if (ratio.size() != 2) return false;
+				config.workload.hotKeys = std::stod(ratio[0]) / 100.0;
+				config.workload.hotOps = std::stod(ratio[1]) / 100.0;
+			}
+			else if (key == "--fill") {
+				config.workload.fill = std::stod(value);
+			}
+			else if (key == "--shuffle") {
+				config.workload.shuffle = true;
+			}
+			else if (key == "--seed") {
+				config.workload.seed = std::stoull(value);
+			}
+			else if (key == "--ops") {
+				config.loop = std::stoi(value);
+			}
+			else if (key == "--duration") {
+				config.duration = std::stoi(value);
+			}
+			else if (key == "--pin") {
+				if (false == parse_placement(value, config.placement)) return false;
+			}
+			else if (key == "--latency") {
+				config.latency = true;
+			}
+			else if (key == "--check") {
+				config.check = true;
+			}
+			else if (key == "--linearizability") {
+				config.linearizability = true;
+			}
+			else if (key == "--perf") {
+				config.perf = true;
+				if (not value.empty()) config.perfRaw = std::stoull(value, nullptr, 0);
+			}
+			else if (key == "--reps") {
+				config.reps = std::stoi(value);
+			}
+			else if (key == "--warmup") {
+				config.warmup = std::stoi(value);
+			}
+			else if (key == "--json") {
+				config.json = value;
+			}
+			else if (key == "--csv") {
+				config.csv = value;
+			}
+			else if (key == "--trace") {
+#if defined(LOCK_TRACE)
+				config.trace = value;
+				if (value.empty()) return false;
+#else
+				std::cout << "--trace needs a build with LOCK_TRACE defined\n";
+				return false;
+#endif
+			}
+			else if (key == "--compare") {
+				config.compare = split(value, ',');
+				if (config.compare.size() != 2) return false;
+			}
+			else {
+				return false;
+			}
+		}
+		catch (const std::exception&) {
+			return false;
+		}
+	}
+
+	auto& w = config.workload;
+	if (config.threads.empty() or w.range <= 0 or config.loop <= 0) return false;
+	if (config.reps < 1 or config.warmup < 0) return false;
+	if (config.duration < 0 or (config.duration > 0 and config.linearizability)) return false;
+	if (w.addRatio < 0 or w.removeRatio < 0 or w.containsRatio < 0) return false;
+	if (w.addRatio + w.removeRatio + w.containsRatio <= 0) return false;
+	if (w.zipfTheta <= 0.0 or w.zipfTheta >= 1.0) return false;
+	if (w.hotKeys <= 0.0 or w.hotKeys > 1.0 or w.hotOps < 0.0 or w.hotOps > 1.0) return false;
+	if (w.fill > 1.0) return false;
+
+	for (int t : config.threads) {
+		if (t < 1 or t > MAX_THREADS) return false;
+	}
+
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	Config config;
+
+	if (false == parse_args(argc, argv, config)) {
+		usage();
+		return -1;
+	}
+
+	std::vector<const SetEntry*> selected;
+	for (auto& name : config.sets) {
+		bool found{ false };
+
+		for (auto& entry : SETS) {
+			if (name == "all" or name == entry.name) {
+				selected.push_back(&entry);
+				found = true;
+			}
+		}
+
+		if (not found) {
+			std::cout << "ERROR. Unknown set " << name << "\n";
+			usage();
+			return -1;
+		}
+	}
+
+	if (not config.compare.empty()) {
+		return compare(config.compare[0], config.compare[1]) ? 0 : -1;
+	}
+
+	auto& w = config.workload;
+	std::cout << "Range : " << w.range
+		<< ", Mix(add/remove/contains) : " << w.addRatio << "/" << w.removeRatio << "/" << w.containsRatio
+		<< ", Dist : " << DIST_NAMES[static_cast<int>(w.dist)]
+		<< ", Fill : " << Workload{ w }.fill() << (w.shuffle ? " (shuffled)" : "")
+		<< ", Ops : " << config.loop;
+	if (config.duration > 0) std::cout << ", Duration : " << config.duration << " ms";
+	if (config.reps > 1 or config.warmup > 0) std::cout << ", Reps : " << config.reps << " (+" << config.warmup << " warm-up)";
+	std::cout << "\n";
+
+	const int max_threads = *std::max_element(config.threads.begin(), config.threads.end());
+	WorkerPool pool{ max_threads, config.placement };
+
+	std::cout << "Placement : " << PLACEMENT_NAMES[static_cast<int>(config.placement)];
+	if (config.placement != PLACEMENT::NONE) {
+		std::cout << " (cpu";
+		for (int i = 0; i < max_threads; ++i) std::cout << " " << pool.cpu_of(i);
+		std::cout << ")";
+	}
+	std::cout << "\n";
+
+	if (config.perf) {
+		PerfCounter probe{ config.perfRaw };
+		probe.start();
+		PerfSample sample = probe.stop();
+
+		std::cout << "Perf counters :";
+		for (int i = 0; i < PERF_EVENTS; ++i) {
+			if (i == PERF_XFER and config.perfRaw == 0) continue;
+			std::cout << " " << PERF_EVENT_NAMES[i] << (sample.valid[i] ? "" : "(unavailable)");
+		}
+		std::cout << "\n";
+	}
+#if defined(SET_STATS)
+	std::cout << "Contention counters : on (SET_STATS)\n";
+#endif
+	std::cout << "\n";
+
+	std::cout << std::left << std::setw(18) << "Set" << std::right
+		<< std::setw(8) << "Threads"
+		<< std::setw(12) << "Time(ms)"
+		<< std::setw(12) << "Mops/s";
+	if (config.reps > 1) std::cout << std::setw(10) << "+-95%";
+	std::cout << std::setw(10) << "Speedup"
+		<< std::setw(12) << "Efficiency" << "\n";
+
+	// calibrate the tick rate here rather than inside the first timed run
+	if (config.duration > 0) ns_per_tick();
+
+	int exit_code{ 0 };
+	Report report;
+	for (auto entry : selected) {
+		auto results = entry->run(entry->name, config, pool);
+		print_table(entry->name, results);
+
+		for (auto& r : results) {
+			if (not r.check.empty() and r.check != "OK") exit_code = -1;
+			if (r.linearizability.rfind("ERROR", 0) == 0) exit_code = -1;
+		}
+		report.emplace_back(entry->name, std::move(results));
+	}
+
+	if (not config.json.empty() and false == write_json(config.json, config, report)) {
+		std::cout << "Cannot write " << config.json << "\n";
+		exit_code = -1;
+	}
+	if (not config.csv.empty() and false == write_csv(config.csv, config, report)) {
+		std::cout << "Cannot write " << config.csv << "\n";
+		exit_code = -1;
+	}
+
+	return exit_code;
+}
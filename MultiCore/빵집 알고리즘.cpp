@@ -6,6 +6,8 @@
 #include <algorithm>
 #include <chrono>
 
+#include "Fairness.h"
+
 /*--------------------------------------------------------------------------------*/
 // Ƽھ α׷ 1 -  ˰ 								  //
 //  - ġũ α׷ õ  α׷ 							  //
@@ -175,9 +177,50 @@ void UseAtomicBakery(AtomicBakery* b, const int thread_id, const int loop_count)
 	}
 }
 
-int main()
+void Fairness(std::chrono::milliseconds duration)
+{
+	std::cout << "\n------------------ Fairness (" << duration.count() << " ms per run) -------------------\n\n";
+
+	for (int num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2) {
+		Bakery bakery{ num_threads };
+		AtomicBakery atomic_bakery{ num_threads };
+
+		auto mutex = run_for(num_threads, duration, [](int) {
+			mtx.lock();
+			sum += 2;
+			mtx.unlock();
+			});
+		auto b = run_for(num_threads, duration, [&](int id) {
+			bakery.lock(id);
+			sum += 2;
+			bakery.unlock(id);
+			});
+		auto ab = run_for(num_threads, duration, [&](int id) {
+			atomic_bakery.lock(id);
+			sum += 2;
+			atomic_bakery.unlock(id);
+			});
+
+		std::cout << num_threads << " Thread Mutex : ";
+		mutex.print(std::cout);
+		std::cout << "\n" << num_threads << " Thread Bakery : ";
+		b.print(std::cout);
+		std::cout << "\n" << num_threads << " Thread AtomicBakery : ";
+		ab.print(std::cout);
+		std::cout << "\n" << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
 {
 	using namespace std::chrono;
+
+	milliseconds duration;
+	if (fairness_mode(argc, argv, duration)) {
+		Fairness(duration);
+		return 0;
+	}
+
 	{
 		auto start = high_resolution_clock::now();
 
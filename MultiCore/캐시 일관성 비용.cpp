@@ -0,0 +1,256 @@
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <array>
+#include <algorithm>
+
+#include "Clock.h"
+#include "WorkerPool.h"
+
+// What cache coherence costs on this machine:
+//   1. round trip of one cache line between every pair of cpus
+//   2. CAS / fetch_add / exchange / seq_cst fence, alone and with every thread on one line
+//   3. fetch_add on private lines vs. false sharing vs. true sharing, between every pair of cpus
+
+struct alignas(64) LINE {
+	std::atomic<int> value{ 0 };
+};
+
+struct alignas(64) PACKED_LINE { // two counters in one cache line
+	std::atomic<int> value[2]{};
+};
+
+int ROUNDS{ 20'000 };     // ping-pong round trips per sample
+int SAMPLES{ 5 };         // the fastest sample is reported
+int OPS{ 10'000'000 };    // operations per atomic / sharing test
+int MAX_CPUS{ 0 };        // 0 : every cpu
+
+enum ATOMIC_OP { OP_CAS, OP_FETCH_ADD, OP_EXCHANGE, OP_FENCE, ATOMIC_OPS };
+const char* ATOMIC_OP_NAMES[ATOMIC_OPS]{ "CAS", "fetch_add", "exchange", "fence" };
+
+void spin_barrier(std::atomic<int>& arrived, int n)
+{
+	arrived++;
+	while (arrived.load() < n);
+}
+
+// Nanoseconds for one round trip of a cache line between cpu_a and cpu_b:
+// a writes an odd value, b answers with the next even one.
+double round_trip(int cpu_a, int cpu_b)
+{
+	LINE line;
+	std::atomic<int> arrived{ 0 };
+
+	std::thread pong{ [&] {
+		pin_thread(cpu_b);
+		spin_barrier(arrived, 2);
+
+		for (int i = 0; i < SAMPLES * ROUNDS; ++i) {
+			while (line.value.load(std::memory_order_acquire) != 2 * i + 1);
+			line.value.store(2 * i + 2, std::memory_order_release);
+		}
+	} };
+
+	pin_thread(cpu_a);
+	spin_barrier(arrived, 2);
+
+	double best{ 1e30 };
+	int v{ 0 };
+	for (int s = 0; s < SAMPLES; ++s) {
+		auto t0 = ticks();
+		for (int i = 0; i < ROUNDS; ++i) {
+			line.value.store(v + 1, std::memory_order_release);
+			while (line.value.load(std::memory_order_acquire) != v + 2);
+			v += 2;
+		}
+		best = std::min(best, (ticks() - t0) * ns_per_tick() / ROUNDS);
+	}
+
+	pong.join();
+	return best;
+}
+
+template <int OP>
+void atomic_loop(std::atomic<int>& a, int count)
+{
+	for (int i = 0; i < count; ++i) {
+		if constexpr (OP == OP_CAS) {
+			int expected = a.load(std::memory_order_relaxed);
+			a.compare_exchange_strong(expected, expected + 1);
+		}
+		else if constexpr (OP == OP_FETCH_ADD) a.fetch_add(1);
+		else if constexpr (OP == OP_EXCHANGE) a.exchange(i);
+		else std::atomic_thread_fence(std::memory_order_seq_cst);
+	}
+}
+
+void atomic_loop(int op, std::atomic<int>& a, int count)
+{
+	switch (op) {
+	case OP_CAS: atomic_loop<OP_CAS>(a, count); break;
+	case OP_FETCH_ADD: atomic_loop<OP_FETCH_ADD>(a, count); break;
+	case OP_EXCHANGE: atomic_loop<OP_EXCHANGE>(a, count); break;
+	default: atomic_loop<OP_FENCE>(a, count); break;
+	}
+}
+
+// Nanoseconds per fetch_add when the threads on cpu_a and cpu_b each update
+// their own line, two words of one line, or the same word.
+void sharing(int cpu_a, int cpu_b, double ns[3])
+{
+	using namespace std::chrono;
+
+	LINE own[2];
+	PACKED_LINE packed;
+	LINE shared;
+
+	for (int mode = 0; mode < 3; ++mode) {
+		std::atomic<int> arrived{ 0 };
+		auto counter = [&](int id) -> std::atomic<int>& {
+			if (mode == 0) return own[id].value;
+			if (mode == 1) return packed.value[id];
+			return shared.value;
+		};
+
+		double elapsed[2]{};
+		auto worker = [&](int id, int cpu) {
+			pin_thread(cpu);
+			auto& c = counter(id);
+			spin_barrier(arrived, 2);
+
+			auto start = steady_clock::now();
+			for (int i = 0; i < OPS; ++i) c.fetch_add(1, std::memory_order_relaxed);
+			elapsed[id] = duration<double, std::nano>(steady_clock::now() - start).count();
+		};
+
+		std::thread other{ worker, 1, cpu_b };
+		worker(0, cpu_a);
+		other.join();
+
+		ns[mode] = std::max(elapsed[0], elapsed[1]) / OPS;
+	}
+}
+
+bool parse_args(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; ++i) {
+		std::string arg{ argv[i] };
+		auto eq = arg.find('=');
+		std::string key = arg.substr(0, eq);
+		std::string value = (eq == std::string::npos) ? "" : arg.substr(eq + 1);
+
+		try {
+			if (key == "--rounds") ROUNDS = std::stoi(value);
+			else if (key == "--samples") SAMPLES = std::stoi(value);
+			else if (key == "--ops") OPS = std::stoi(value);
+			else if (key == "--cpus") MAX_CPUS = std::stoi(value);
+			else return false;
+		}
+		catch (const std::exception&) {
+			return false;
+		}
+	}
+
+	return ROUNDS > 0 and SAMPLES > 0 and OPS > 0 and MAX_CPUS >= 0;
+}
+
+int main(int argc, char* argv[])
+{
+	using namespace std::chrono;
+
+	if (false == parse_args(argc, argv)) {
+		std::cout << "Usage: [--rounds=N] [--samples=N] [--ops=N] [--cpus=N]\n";
+		return -1;
+	}
+
+	auto cpus = cpu_topology();
+	if (MAX_CPUS > 0 and MAX_CPUS < static_cast<int>(cpus.size())) cpus.resize(MAX_CPUS);
+	const int n = static_cast<int>(cpus.size());
+	if (n == 0) {
+		std::cout << "Cannot read the cpu topology\n";
+		return -1;
+	}
+
+	std::cout << "CPU (package/core/sibling) :";
+	for (auto& c : cpus) std::cout << "  " << c.id << " (" << c.package << "/" << c.core << "/" << c.sibling << ")";
+	std::cout << "\n\n";
+
+	std::cout << std::fixed << std::setprecision(1);
+	{
+		std::cout << "Core-to-core round trip (ns), row : writer, column : responder\n";
+		std::cout << std::setw(6) << "";
+		for (auto& c : cpus) std::cout << std::setw(8) << c.id;
+		std::cout << "\n";
+
+		for (auto& a : cpus) {
+			std::cout << std::setw(6) << a.id;
+			for (auto& b : cpus) {
+				if (&a == &b) std::cout << std::setw(8) << "-";
+				else std::cout << std::setw(8) << round_trip(a.id, b.id);
+			}
+			std::cout << std::endl;
+		}
+		if (n < 2) std::cout << "(needs at least two cpus)\n";
+		std::cout << "\n";
+	}
+
+	{
+		std::cout << "Atomic operation cost (ns per op), every thread on the same line\n";
+		std::cout << std::setw(8) << "Threads";
+		for (auto name : ATOMIC_OP_NAMES) std::cout << std::setw(12) << name;
+		std::cout << "\n";
+
+		WorkerPool pool{ n, PLACEMENT::COMPACT };
+		for (int num_threads = 1; num_threads <= n; num_threads *= 2) {
+			std::cout << std::setw(8) << num_threads;
+			for (int op = 0; op < ATOMIC_OPS; ++op) {
+				LINE line;
+				const int count = OPS / num_threads;
+				auto elapsed = pool.run(num_threads, [&](int) {
+					pool.start_line();
+					atomic_loop(op, line.value, count);
+					pool.finish_line();
+					});
+
+				// latency seen by each thread: wall time over its own operations
+				std::cout << std::setw(12) << duration<double, std::nano>(elapsed).count() / count;
+			}
+			std::cout << std::endl;
+		}
+		std::cout << "\n";
+	}
+
+	{
+		// symmetric, so every pair runs once
+		std::vector<std::vector<std::array<double, 3>>> ns(n, std::vector<std::array<double, 3>>(n));
+		for (int a = 0; a < n; ++a) {
+			for (int b = a + 1; b < n; ++b) {
+				sharing(cpus[a].id, cpus[b].id, ns[a][b].data());
+				ns[b][a] = ns[a][b];
+			}
+		}
+
+		const char* MODE_NAMES[3]{ "private lines", "false sharing", "true sharing" };
+		for (int mode = 0; mode < 3; ++mode) {
+			std::cout << "fetch_add by a pair of cpus (ns per op), " << MODE_NAMES[mode] << "\n";
+			std::cout << std::setw(6) << "";
+			for (auto& c : cpus) std::cout << std::setw(8) << c.id;
+			std::cout << "\n";
+
+			for (int a = 0; a < n; ++a) {
+				std::cout << std::setw(6) << cpus[a].id;
+				for (int b = 0; b < n; ++b) {
+					if (a == b) std::cout << std::setw(8) << "-";
+					else std::cout << std::setw(8) << ns[a][b][mode];
+				}
+				std::cout << "\n";
+			}
+			if (n < 2) std::cout << "(needs at least two cpus)\n";
+			std::cout << "\n";
+		}
+	}
+}
@@ -5,6 +5,8 @@
 #include <chrono>
 #include <atomic>
 
+#include "Fairness.h"
+
 const int MAX_THREADS{ 2 };
 
 volatile int sum{ 0 };
@@ -46,9 +48,32 @@ void worker_func2(const int loop_count)
 	}
 }
 
-int main()
+int main(int argc, char* argv[])
 {
 	using namespace std::chrono;
+
+	milliseconds duration;
+	if (fairness_mode(argc, argv, duration)) {
+		std::cout << "Fairness (" << duration.count() << " ms per run)\n";
+		auto peterson = run_for(MAX_THREADS, duration, [](int id) {
+			p_lock(id);
+			sum += 2;
+			p_unlock(id);
+			});
+		auto mutex = run_for(MAX_THREADS, duration, [](int) {
+			mtx.lock();
+			sum += 2;
+			mtx.unlock();
+			});
+
+		std::cout << MAX_THREADS << " Threads Peterson : ";
+		peterson.print(std::cout);
+		std::cout << "\n" << MAX_THREADS << " Threads Mutex : ";
+		mutex.print(std::cout);
+		std::cout << std::endl;
+		return 0;
+	}
+
 	{
 		auto start = high_resolution_clock::now();
 